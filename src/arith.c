@@ -0,0 +1,794 @@
+#include "arith.h"
+#include "output.h"
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct ArithCompiler {
+	ShellState *shell;
+	const char *expr;
+	size_t length;
+	size_t pos;
+	ArithOp *code;
+	size_t count;
+	size_t capacity;
+	int depth;
+	const char *error;
+} ArithCompiler;
+
+/* longest operators first, so that "<<=" is not read as "<" */
+static const char *const arith_operators[] = {
+	"<<=", ">>=", "&&", "||", "==", "!=", "<=", ">=", "<<", ">>",
+	"+=",  "-=",  "*=", "/=", "%=", "&=", "^=", "|=", "++", "--",
+	"+",   "-",   "*",  "/",  "%",  "<",  ">",  "&",  "|",  "^",
+	"!",   "~",   "?",  ":",  "=",  "(",  ")",
+};
+
+static bool arith_compile_assign(ArithCompiler *c);
+
+/**
+ * arith_skip_blanks - Skips whitespace in the expression.
+ * @c: Pointer to the ArithCompiler structure.
+ */
+static void arith_skip_blanks(ArithCompiler *c)
+{
+	while (c->pos < c->length && isspace((unsigned char)c->expr[c->pos]))
+		c->pos++;
+}
+
+/**
+ * arith_peek_operator - Returns the operator at the current position.
+ * @c: Pointer to the ArithCompiler structure.
+ * Return: The operator, or NULL if none starts here.
+ */
+static const char *arith_peek_operator(ArithCompiler *c)
+{
+	arith_skip_blanks(c);
+	for (size_t i = 0; i < sizeof(arith_operators) / sizeof(char *); i++) {
+		size_t len = strlen(arith_operators[i]);
+		if (c->pos + len <= c->length &&
+		    strncmp(c->expr + c->pos, arith_operators[i], len) == 0)
+			return arith_operators[i];
+	}
+	return NULL;
+}
+
+/**
+ * arith_accept - Consumes the given operator if it comes next.
+ * @c: Pointer to the ArithCompiler structure.
+ * @op: The operator.
+ * Return: true if it was consumed, false otherwise.
+ */
+static bool arith_accept(ArithCompiler *c, const char *op)
+{
+	const char *next = arith_peek_operator(c);
+
+	if (!next || strcmp(next, op) != 0)
+		return false;
+	c->pos += strlen(op);
+	return true;
+}
+
+/**
+ * arith_fail - Records the first compile error.
+ * @c: Pointer to the ArithCompiler structure.
+ * @message: Description of the error.
+ * Return: Always false.
+ */
+static bool arith_fail(ArithCompiler *c, const char *message)
+{
+	if (!c->error)
+		c->error = message;
+	return false;
+}
+
+/**
+ * arith_emit - Appends an instruction to the program.
+ * @c: Pointer to the ArithCompiler structure.
+ * @opcode: The instruction.
+ * @value: Constant or jump target.
+ * @name: Variable name for ARITH_LOAD and ARITH_STORE, owned by the program.
+ * @effect: Change in stack depth caused by the instruction.
+ * Return: true on success, false on failure.
+ */
+static bool arith_emit(ArithCompiler *c, ArithOpcode opcode, long long value,
+		       char *name, int effect)
+{
+	if (c->count == c->capacity) {
+		size_t capacity = c->capacity ? c->capacity * 2 : 16;
+		ArithOp *code = realloc(c->code, sizeof(ArithOp) * capacity);
+		if (!code) {
+			free(name);
+			c->shell->fatal_error = true;
+			return arith_fail(c, "out of memory");
+		}
+		c->code = code;
+		c->capacity = capacity;
+	}
+	c->code[c->count].opcode = opcode;
+	c->code[c->count].value = value;
+	c->code[c->count].name = name;
+	c->count++;
+
+	c->depth += effect;
+	if (c->depth > ARITH_STACK_MAX)
+		return arith_fail(c, "expression too complex");
+	return true;
+}
+
+/**
+ * arith_read_name - Reads a variable name at the current position.
+ * @c: Pointer to the ArithCompiler structure.
+ * Return: Newly allocated name, or NULL if no name starts here.
+ */
+static char *arith_read_name(ArithCompiler *c)
+{
+	size_t start, end;
+	bool braced = false;
+
+	arith_skip_blanks(c);
+	start = c->pos;
+	if (start < c->length && c->expr[start] == '$') {
+		start++;
+		if (start < c->length && c->expr[start] == '{') {
+			braced = true;
+			start++;
+		}
+	}
+	end = start;
+	if (end >= c->length ||
+	    !(isalpha((unsigned char)c->expr[end]) || c->expr[end] == '_'))
+		return NULL;
+	while (end < c->length && (isalnum((unsigned char)c->expr[end]) ||
+				   c->expr[end] == '_'))
+		end++;
+	if (braced) {
+		if (end >= c->length || c->expr[end] != '}')
+			return NULL;
+		c->pos = end + 1;
+	} else {
+		c->pos = end;
+	}
+
+	char *name = strndup(c->expr + start, end - start);
+	if (!name)
+		c->shell->fatal_error = true;
+	return name;
+}
+
+/**
+ * arith_emit_update - Emits "name = name op value" for a value on the stack.
+ * @c: Pointer to the ArithCompiler structure.
+ * @name: The variable name; ownership is taken.
+ * @opcode: The binary operation applied.
+ * @post: Leave the old value on the stack instead of the new one.
+ * Return: true on success, false on failure.
+ */
+static bool arith_emit_update(ArithCompiler *c, char *name,
+			      ArithOpcode opcode, bool post)
+{
+	char *load = strdup(name);
+
+	if (!load) {
+		free(name);
+		c->shell->fatal_error = true;
+		return arith_fail(c, "out of memory");
+	}
+	if (post) {
+		char *copy = strdup(name);
+		if (!copy) {
+			free(load);
+			free(name);
+			c->shell->fatal_error = true;
+			return arith_fail(c, "out of memory");
+		}
+		if (!arith_emit(c, ARITH_LOAD, 0, copy, 1)) {
+			free(load);
+			free(name);
+			return false;
+		}
+	}
+	if (!arith_emit(c, ARITH_LOAD, 0, load, 1)) {
+		free(name);
+		return false;
+	}
+	if (!arith_emit(c, ARITH_PUSH, 1, NULL, 1) ||
+	    !arith_emit(c, opcode, 0, NULL, -1)) {
+		free(name);
+		return false;
+	}
+	if (!arith_emit(c, ARITH_STORE, 0, name, 0))
+		return false;
+	return !post || arith_emit(c, ARITH_POP, 0, NULL, -1);
+}
+
+/**
+ * arith_compile_primary - Compiles a number, variable or parenthesized
+ *                         expression, with prefix or postfix ++ and --.
+ * @c: Pointer to the ArithCompiler structure.
+ * Return: true on success, false on failure.
+ */
+static bool arith_compile_primary(ArithCompiler *c)
+{
+	char *name;
+
+	if (arith_accept(c, "++") || arith_accept(c, "--")) {
+		ArithOpcode opcode = c->expr[c->pos - 1] == '+' ? ARITH_ADD :
+								   ARITH_SUB;
+		name = arith_read_name(c);
+		if (!name)
+			return arith_fail(c, "expecting variable");
+		return arith_emit_update(c, name, opcode, false);
+	}
+
+	if (arith_accept(c, "(")) {
+		if (!arith_compile_assign(c))
+			return false;
+		if (!arith_accept(c, ")"))
+			return arith_fail(c, "expecting ')'");
+		return true;
+	}
+
+	arith_skip_blanks(c);
+	if (c->pos < c->length && isdigit((unsigned char)c->expr[c->pos])) {
+		char buffer[64];
+		size_t start = c->pos, len;
+		char *end;
+
+		while (c->pos < c->length &&
+		       isalnum((unsigned char)c->expr[c->pos]))
+			c->pos++;
+		len = c->pos - start;
+		if (len >= sizeof(buffer))
+			return arith_fail(c, "number too long");
+		memcpy(buffer, c->expr + start, len);
+		buffer[len] = '\0';
+		errno = 0;
+		long long value = strtoll(buffer, &end, 0);
+		if (*end || errno)
+			return arith_fail(c, "bad number");
+		return arith_emit(c, ARITH_PUSH, value, NULL, 1);
+	}
+
+	if (c->pos + 1 < c->length && c->expr[c->pos] == '$' &&
+	    strchr("#?$0123456789", c->expr[c->pos + 1])) {
+		char special = c->expr[c->pos + 1];
+		long long param = special >= '0' && special <= '9' ?
+					  special - '0' :
+					  -special;
+		c->pos += 2;
+		return arith_emit(c, ARITH_PARAM, param, NULL, 1);
+	}
+
+	name = arith_read_name(c);
+	if (!name)
+		return arith_fail(c, "expecting primary");
+	if (arith_accept(c, "++"))
+		return arith_emit_update(c, name, ARITH_ADD, true);
+	if (arith_accept(c, "--"))
+		return arith_emit_update(c, name, ARITH_SUB, true);
+	return arith_emit(c, ARITH_LOAD, 0, name, 1);
+}
+
+/**
+ * arith_compile_unary - Compiles a unary expression.
+ * @c: Pointer to the ArithCompiler structure.
+ * Return: true on success, false on failure.
+ */
+static bool arith_compile_unary(ArithCompiler *c)
+{
+	const char *op = arith_peek_operator(c);
+
+	if (op && strlen(op) == 1 && strchr("+-!~", op[0])) {
+		c->pos++;
+		if (!arith_compile_unary(c))
+			return false;
+		switch (op[0]) {
+		case '-':
+			return arith_emit(c, ARITH_NEG, 0, NULL, 0);
+		case '!':
+			return arith_emit(c, ARITH_NOT, 0, NULL, 0);
+		case '~':
+			return arith_emit(c, ARITH_BITNOT, 0, NULL, 0);
+		default:
+			return true;
+		}
+	}
+	return arith_compile_primary(c);
+}
+
+typedef struct ArithBinary {
+	const char *op;
+	ArithOpcode opcode;
+	int precedence;
+} ArithBinary;
+
+static const ArithBinary arith_binaries[] = {
+	{ "*", ARITH_MUL, 10 },	    { "/", ARITH_DIV, 10 },
+	{ "%", ARITH_MOD, 10 },	    { "+", ARITH_ADD, 9 },
+	{ "-", ARITH_SUB, 9 },	    { "<<", ARITH_SHL, 8 },
+	{ ">>", ARITH_SHR, 8 },	    { "<", ARITH_LT, 7 },
+	{ "<=", ARITH_LE, 7 },	    { ">", ARITH_GT, 7 },
+	{ ">=", ARITH_GE, 7 },	    { "==", ARITH_EQ, 6 },
+	{ "!=", ARITH_NE, 6 },	    { "&", ARITH_BITAND, 5 },
+	{ "^", ARITH_BITXOR, 4 },   { "|", ARITH_BITOR, 3 },
+	{ "&&", ARITH_AND_JUMP, 2 }, { "||", ARITH_OR_JUMP, 1 },
+};
+
+/**
+ * arith_binary - Finds the binary operator at the current position.
+ * @c: Pointer to the ArithCompiler structure.
+ * Return: The operator description, or NULL if none comes next.
+ */
+static const ArithBinary *arith_binary(ArithCompiler *c)
+{
+	const char *op = arith_peek_operator(c);
+
+	if (!op)
+		return NULL;
+	for (size_t i = 0; i < sizeof(arith_binaries) / sizeof(ArithBinary);
+	     i++) {
+		if (strcmp(arith_binaries[i].op, op) == 0)
+			return &arith_binaries[i];
+	}
+	return NULL;
+}
+
+/**
+ * arith_compile_binary - Compiles binary operators by precedence climbing.
+ * @c: Pointer to the ArithCompiler structure.
+ * @min_precedence: Lowest precedence accepted at this level.
+ *
+ * && and || compile to jumps, so their right operand is skipped at run
+ * time when the left one decides the result.
+ *
+ * Return: true on success, false on failure.
+ */
+static bool arith_compile_binary(ArithCompiler *c, int min_precedence)
+{
+	const ArithBinary *binary;
+
+	if (!arith_compile_unary(c))
+		return false;
+
+	while ((binary = arith_binary(c)) &&
+	       binary->precedence >= min_precedence) {
+		c->pos += strlen(binary->op);
+
+		if (binary->opcode == ARITH_AND_JUMP ||
+		    binary->opcode == ARITH_OR_JUMP) {
+			size_t jump = c->count;
+			if (!arith_emit(c, binary->opcode, 0, NULL, -1) ||
+			    !arith_compile_binary(c, binary->precedence + 1) ||
+			    !arith_emit(c, ARITH_BOOL, 0, NULL, 0))
+				return false;
+			c->code[jump].value = (long long)c->count;
+			continue;
+		}
+
+		if (!arith_compile_binary(c, binary->precedence + 1) ||
+		    !arith_emit(c, binary->opcode, 0, NULL, -1))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * arith_compile_conditional - Compiles "cond ? a : b".
+ * @c: Pointer to the ArithCompiler structure.
+ * Return: true on success, false on failure.
+ */
+static bool arith_compile_conditional(ArithCompiler *c)
+{
+	size_t jump_else, jump_end;
+
+	if (!arith_compile_binary(c, 1))
+		return false;
+	if (!arith_accept(c, "?"))
+		return true;
+
+	jump_else = c->count;
+	if (!arith_emit(c, ARITH_JUMP_ZERO, 0, NULL, -1) ||
+	    !arith_compile_assign(c))
+		return false;
+	if (!arith_accept(c, ":"))
+		return arith_fail(c, "expecting ':'");
+
+	jump_end = c->count;
+	/* only one branch runs, so the else branch starts at the same depth */
+	if (!arith_emit(c, ARITH_JUMP, 0, NULL, -1))
+		return false;
+	c->code[jump_else].value = (long long)c->count;
+	if (!arith_compile_conditional(c))
+		return false;
+	c->code[jump_end].value = (long long)c->count;
+	return true;
+}
+
+/**
+ * arith_compile_assign - Compiles an assignment or conditional expression.
+ * @c: Pointer to the ArithCompiler structure.
+ * Return: true on success, false on failure.
+ */
+static bool arith_compile_assign(ArithCompiler *c)
+{
+	static const struct {
+		const char *op;
+		ArithOpcode opcode;
+	} compound[] = {
+		{ "*=", ARITH_MUL },	{ "/=", ARITH_DIV },
+		{ "%=", ARITH_MOD },	{ "+=", ARITH_ADD },
+		{ "-=", ARITH_SUB },	{ "<<=", ARITH_SHL },
+		{ ">>=", ARITH_SHR },	{ "&=", ARITH_BITAND },
+		{ "^=", ARITH_BITXOR }, { "|=", ARITH_BITOR },
+	};
+	size_t start = c->pos;
+	char *name = arith_read_name(c);
+	const char *op;
+
+	if (!name) {
+		if (c->shell->fatal_error)
+			return arith_fail(c, "out of memory");
+		return arith_compile_conditional(c);
+	}
+
+	op = arith_peek_operator(c);
+	if (op && strcmp(op, "=") == 0) {
+		c->pos++;
+		if (!arith_compile_assign(c)) {
+			free(name);
+			return false;
+		}
+		return arith_emit(c, ARITH_STORE, 0, name, 0);
+	}
+	for (size_t i = 0; op && i < sizeof(compound) / sizeof(compound[0]);
+	     i++) {
+		if (strcmp(op, compound[i].op) != 0)
+			continue;
+		c->pos += strlen(op);
+		char *load = strdup(name);
+		if (!load) {
+			free(name);
+			c->shell->fatal_error = true;
+			return arith_fail(c, "out of memory");
+		}
+		if (!arith_emit(c, ARITH_LOAD, 0, load, 1) ||
+		    !arith_compile_assign(c) ||
+		    !arith_emit(c, compound[i].opcode, 0, NULL, -1)) {
+			free(name);
+			return false;
+		}
+		return arith_emit(c, ARITH_STORE, 0, name, 0);
+	}
+
+	/* not an assignment: compile the name again as an operand */
+	free(name);
+	c->pos = start;
+	return arith_compile_conditional(c);
+}
+
+/**
+ * arith_free - Frees a compiled expression.
+ * @arith: Pointer to the Arith structure.
+ */
+static void arith_free(Arith *arith)
+{
+	for (size_t i = 0; i < arith->length; i++)
+		free(arith->code[i].name);
+	free(arith->code);
+	free(arith);
+}
+
+/**
+ * arith_compile - Compiles an expression to postfix code.
+ * @shell: Pointer to the shell state.
+ * @expr: The expression text.
+ * @length: Length of the expression.
+ * Return: The compiled expression, or NULL after reporting an error.
+ */
+static Arith *arith_compile(ShellState *shell, const char *expr,
+			    size_t length)
+{
+	ArithCompiler c = { shell, expr, length, 0, NULL, 0, 0, 0, NULL };
+	Arith *arith = malloc(sizeof(Arith));
+
+	if (!arith) {
+		shell->fatal_error = true;
+		return NULL;
+	}
+
+	arith_skip_blanks(&c);
+	if (c.pos == length) {
+		arith_emit(&c, ARITH_PUSH, 0, NULL, 1);
+	} else if (arith_compile_assign(&c)) {
+		arith_skip_blanks(&c);
+		if (c.pos != length)
+			arith_fail(&c, "expecting end of expression");
+	}
+
+	arith->source = expr;
+	arith->code = c.code;
+	arith->length = c.count;
+	arith->next = NULL;
+	if (!c.error)
+		return arith;
+
+	if (!shell->fatal_error) {
+		shell->had_error = true;
+		output_printf(STDERR_FILENO,
+			      "%s: %d: arithmetic expression: %s: \"%.*s\"\n",
+			      shell->name, shell->line_number, c.error,
+			      (int)length, expr);
+	}
+	arith_free(arith);
+	return NULL;
+}
+
+/**
+ * arith_number - Converts the value of a parameter to an integer.
+ * @shell: Pointer to the shell state.
+ * @text: The value; NULL or empty reads as 0.
+ * @value: Where to store the integer.
+ * Return: true on success, false if the value is not a number.
+ */
+static bool arith_number(ShellState *shell, const char *text,
+			 long long *value)
+{
+	char *end;
+
+	if (!text || !*text) {
+		*value = 0;
+		return true;
+	}
+	errno = 0;
+	*value = strtoll(text, &end, 0);
+	while (isspace((unsigned char)*end))
+		end++;
+	if (*end || errno) {
+		shell->had_error = true;
+		output_printf(STDERR_FILENO, "%s: %d: Illegal number: %s\n",
+			      shell->name, shell->line_number, text);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * arith_param - Reads $1 to $9, $#, $? or $$ as an integer.
+ * @shell: Pointer to the shell state.
+ * @param: The positional index, or the negated special character.
+ * @value: Where to store the integer.
+ * Return: true on success, false if the value is not a number.
+ */
+static bool arith_param(ShellState *shell, long long param, long long *value)
+{
+	switch (param) {
+	case -'#':
+		*value = shell->positional_count;
+		return true;
+	case -'?':
+		*value = shell->last_status;
+		return true;
+	case -'$':
+		*value = shell->pid;
+		return true;
+	case 0:
+		return arith_number(shell, shell->name, value);
+	default:
+		if (param > shell->positional_count)
+			return arith_number(shell, NULL, value);
+		return arith_number(shell, shell->positional[param - 1], value);
+	}
+}
+
+/**
+ * arith_run - Evaluates a compiled expression.
+ * @shell: Pointer to the shell state.
+ * @arith: Pointer to the Arith structure.
+ * @result: Where to store the value of the expression.
+ *
+ * Arithmetic wraps around in 64 bits, as the shell's integers are longs.
+ *
+ * Return: true on success, false after reporting an error.
+ */
+static bool arith_run(ShellState *shell, Arith *arith, long long *result)
+{
+	long long stack[ARITH_STACK_MAX];
+	int top = 0;
+	char number[32];
+	const char *text;
+
+	for (size_t pc = 0; pc < arith->length; pc++) {
+		ArithOp *op = &arith->code[pc];
+		unsigned long long a, b;
+
+		switch (op->opcode) {
+		case ARITH_PUSH:
+			stack[top++] = op->value;
+			continue;
+		case ARITH_LOAD:
+			text = var_get(&shell->vars, op->name);
+			if (!arith_number(shell, text, &stack[top++]))
+				return false;
+			continue;
+		case ARITH_PARAM:
+			if (!arith_param(shell, op->value, &stack[top++]))
+				return false;
+			continue;
+		case ARITH_STORE:
+			snprintf(number, sizeof(number), "%lld",
+				 stack[top - 1]);
+			if (!var_set(&shell->vars, op->name, number, false)) {
+				shell->fatal_error = true;
+				return false;
+			}
+			continue;
+		case ARITH_POP:
+			top--;
+			continue;
+		case ARITH_NEG:
+			a = stack[top - 1];
+			stack[top - 1] = (long long)(0 - a);
+			continue;
+		case ARITH_NOT:
+			stack[top - 1] = !stack[top - 1];
+			continue;
+		case ARITH_BITNOT:
+			stack[top - 1] = ~stack[top - 1];
+			continue;
+		case ARITH_BOOL:
+			stack[top - 1] = stack[top - 1] != 0;
+			continue;
+		case ARITH_AND_JUMP:
+			if (!stack[--top]) {
+				stack[top++] = 0;
+				pc = op->value - 1;
+			}
+			continue;
+		case ARITH_OR_JUMP:
+			if (stack[--top]) {
+				stack[top++] = 1;
+				pc = op->value - 1;
+			}
+			continue;
+		case ARITH_JUMP_ZERO:
+			if (!stack[--top])
+				pc = op->value - 1;
+			continue;
+		case ARITH_JUMP:
+			pc = op->value - 1;
+			continue;
+		default:
+			break;
+		}
+
+		/* binary operators; unsigned math keeps overflow defined */
+		top--;
+		a = stack[top - 1];
+		b = stack[top];
+		switch (op->opcode) {
+		case ARITH_MUL:
+			stack[top - 1] = (long long)(a * b);
+			break;
+		case ARITH_DIV:
+		case ARITH_MOD:
+			if (stack[top] == 0) {
+				shell->had_error = true;
+				output_printf(STDERR_FILENO,
+					      "%s: %d: arithmetic expression: "
+					      "division by zero\n",
+					      shell->name, shell->line_number);
+				return false;
+			}
+			if (stack[top] == -1)
+				stack[top - 1] = op->opcode == ARITH_DIV ?
+							 (long long)-a :
+							 0;
+			else if (op->opcode == ARITH_DIV)
+				stack[top - 1] /= stack[top];
+			else
+				stack[top - 1] %= stack[top];
+			break;
+		case ARITH_ADD:
+			stack[top - 1] = (long long)(a + b);
+			break;
+		case ARITH_SUB:
+			stack[top - 1] = (long long)(a - b);
+			break;
+		case ARITH_SHL:
+			stack[top - 1] = (long long)(a << (b & 63));
+			break;
+		case ARITH_SHR:
+			stack[top - 1] >>= (b & 63);
+			break;
+		case ARITH_LT:
+			stack[top - 1] = stack[top - 1] < stack[top];
+			break;
+		case ARITH_LE:
+			stack[top - 1] = stack[top - 1] <= stack[top];
+			break;
+		case ARITH_GT:
+			stack[top - 1] = stack[top - 1] > stack[top];
+			break;
+		case ARITH_GE:
+			stack[top - 1] = stack[top - 1] >= stack[top];
+			break;
+		case ARITH_EQ:
+			stack[top - 1] = stack[top - 1] == stack[top];
+			break;
+		case ARITH_NE:
+			stack[top - 1] = stack[top - 1] != stack[top];
+			break;
+		case ARITH_BITAND:
+			stack[top - 1] &= stack[top];
+			break;
+		case ARITH_BITXOR:
+			stack[top - 1] ^= stack[top];
+			break;
+		case ARITH_BITOR:
+			stack[top - 1] |= stack[top];
+			break;
+		default:
+			break;
+		}
+	}
+
+	*result = stack[top - 1];
+	return true;
+}
+
+/**
+ * arith_expand - Evaluates the expression of a $((...)) expansion.
+ * @shell: Pointer to the shell state.
+ * @expr: The expression text, inside a word owned by a command tree.
+ * @length: Length of the expression.
+ * @cache: List of expressions compiled for the command, or NULL.
+ * @result: Where to store the value of the expression.
+ *
+ * Compiled code is cached by the address of the expression text, which
+ * is stable for as long as the command tree lives; a loop compiles each
+ * expression once.
+ *
+ * Return: true on success, false after reporting an error.
+ */
+bool arith_expand(ShellState *shell, const char *expr, size_t length,
+		  Arith **cache, long long *result)
+{
+	Arith *arith = NULL;
+	bool ok;
+
+	if (cache) {
+		for (arith = *cache; arith; arith = arith->next) {
+			if (arith->source == expr)
+				return arith_run(shell, arith, result);
+		}
+	}
+
+	arith = arith_compile(shell, expr, length);
+	if (!arith)
+		return false;
+	ok = arith_run(shell, arith, result);
+	if (cache) {
+		arith->next = *cache;
+		*cache = arith;
+	} else {
+		arith_free(arith);
+	}
+	return ok;
+}
+
+/**
+ * arith_free_list - Frees a cache of compiled expressions.
+ * @list: Head of the list, may be NULL.
+ */
+void arith_free_list(Arith *list)
+{
+	while (list) {
+		Arith *next = list->next;
+		arith_free(list);
+		list = next;
+	}
+}
@@ -0,0 +1,59 @@
+#ifndef ARITH_H
+#define ARITH_H
+
+#include "shell.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#define ARITH_STACK_MAX 64
+
+typedef enum ArithOpcode {
+	ARITH_PUSH,
+	ARITH_LOAD,
+	ARITH_PARAM,
+	ARITH_STORE,
+	ARITH_POP,
+	ARITH_NEG,
+	ARITH_NOT,
+	ARITH_BITNOT,
+	ARITH_BOOL,
+	ARITH_MUL,
+	ARITH_DIV,
+	ARITH_MOD,
+	ARITH_ADD,
+	ARITH_SUB,
+	ARITH_SHL,
+	ARITH_SHR,
+	ARITH_LT,
+	ARITH_LE,
+	ARITH_GT,
+	ARITH_GE,
+	ARITH_EQ,
+	ARITH_NE,
+	ARITH_BITAND,
+	ARITH_BITXOR,
+	ARITH_BITOR,
+	ARITH_AND_JUMP,
+	ARITH_OR_JUMP,
+	ARITH_JUMP_ZERO,
+	ARITH_JUMP,
+} ArithOpcode;
+
+typedef struct ArithOp {
+	ArithOpcode opcode;
+	long long value;
+	char *name;
+} ArithOp;
+
+typedef struct Arith {
+	const char *source;
+	ArithOp *code;
+	size_t length;
+	struct Arith *next;
+} Arith;
+
+bool arith_expand(ShellState *shell, const char *expr, size_t length,
+		  Arith **cache, long long *result);
+void arith_free_list(Arith *list);
+
+#endif
@@ -0,0 +1,175 @@
+#include "bench.h"
+#include "command.h"
+#include "counters.h"
+#include "executor.h"
+#include "lexer.h"
+#include "output.h"
+#include "parser.h"
+#include "token.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * bench_compare - Orders run times for qsort.
+ * @a: Pointer to the first time.
+ * @b: Pointer to the second time.
+ * Return: Negative, zero or positive as for strcmp.
+ */
+static int bench_compare(const void *a, const void *b)
+{
+	long long x = *(const long long *)a;
+	long long y = *(const long long *)b;
+
+	return (x > y) - (x < y);
+}
+
+/**
+ * bench_percentile - Returns a nearest-rank percentile.
+ * @sorted: Run times in ascending order.
+ * @runs: Number of runs.
+ * @percent: The percentile.
+ * Return: The run time at that percentile.
+ */
+static long long bench_percentile(const long long *sorted, int runs,
+				  int percent)
+{
+	long long rank = ((long long)percent * runs + 99) / 100;
+
+	return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+/**
+ * bench_report - Writes the results of a benchmark to standard error.
+ * @times: Wall time of each run in nanoseconds, sorted in place.
+ * @runs: Number of runs.
+ * @total: Counter totals over all runs.
+ */
+static void bench_report(long long *times, int runs, const Counters *total)
+{
+	static const int percents[] = { 50, 95, 99 };
+
+	qsort(times, runs, sizeof(long long), bench_compare);
+	output_printf(STDERR_FILENO, "runs\t%d\n", runs);
+	output_printf(STDERR_FILENO, "min\t%.3fms\n", times[0] / 1e6);
+	for (size_t i = 0; i < sizeof(percents) / sizeof(percents[0]); i++)
+		output_printf(STDERR_FILENO, "p%d\t%.3fms\n", percents[i],
+			      bench_percentile(times, runs, percents[i]) /
+				      1e6);
+	for (int i = 0; i < COUNTER_COUNT; i++)
+		output_printf(STDERR_FILENO, "%s\t%.2f\n", counter_name(i),
+			      (double)total->values[i] / runs);
+}
+
+/**
+ * bench_run_once - Runs a parsed script once, in a forked subshell.
+ * @shell: Pointer to the shell state.
+ * @command: The parsed script.
+ * @elapsed: Set to the wall time of the run in nanoseconds.
+ * @status: Set to the exit status of the run.
+ * Return: true on success, false if the subshell could not be run.
+ */
+static bool bench_run_once(ShellState *shell, Command *command,
+			   long long *elapsed, int *status)
+{
+	struct timespec start, end;
+	int wstatus;
+	pid_t pid;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	pid = fork();
+	if (pid < 0)
+		return false;
+	if (pid == 0) {
+		int result = execute_command(shell, command);
+		output_flush_all();
+		_exit(shell->fatal_error ? 2 : result);
+	}
+	while (waitpid(pid, &wstatus, 0) < 0) {
+		if (errno != EINTR)
+			return false;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	*elapsed = (end.tv_sec - start.tv_sec) * 1000000000LL +
+		   (end.tv_nsec - start.tv_nsec);
+	*status = WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) :
+				       128 + WTERMSIG(wstatus);
+	return true;
+}
+
+/**
+ * bench_run - Runs a script repeatedly and reports its timing.
+ * @shell: Pointer to the shell state.
+ * @stream: The script.
+ * @runs: Number of runs.
+ *
+ * The script is parsed once, then each run forks a subshell from the same
+ * starting state, so variables and functions do not leak between runs.
+ * Forks, execs, direct system calls and allocations are counted by all
+ * processes of a run; the fork and wait of the benchmark itself are left
+ * out.
+ *
+ * Return: The exit status of the last run, or 2 on error.
+ */
+int bench_run(ShellState *shell, FILE *stream, int runs)
+{
+	char *source = NULL;
+	size_t size = 0;
+	long long *times = malloc(sizeof(long long) * runs);
+	Counters total = { { 0 }, { 0 } };
+	int status = 0;
+
+	if (!times || !counters_share()) {
+		output_printf(STDERR_FILENO, "Error: malloc failed\n");
+		free(times);
+		return 2;
+	}
+	if (getdelim(&source, &size, '\0', stream) < 0) {
+		free(source);
+		source = NULL;
+	}
+
+	shell->line_number = 1;
+	Token *tokens = tokenize(shell, source ? source : "");
+	Command *command = NULL;
+	if (!shell->had_error && !shell->fatal_error)
+		command = parse(shell, tokens);
+	if (shell->had_error || shell->fatal_error) {
+		token_free_list(tokens);
+		free(source);
+		free(times);
+		return 2;
+	}
+
+	output_flush_all();
+	for (int i = 0; i < runs; i++) {
+		Counters before, after;
+
+		counters_snapshot(&before);
+		if (!bench_run_once(shell, command, &times[i], &status)) {
+			output_printf(STDERR_FILENO, "%s: bench: %s\n",
+				      shell->name, strerror(errno));
+			runs = i;
+			status = 2;
+			break;
+		}
+		counters_snapshot(&after);
+		for (int c = 0; c < COUNTER_COUNT; c++)
+			total.values[c] += after.values[c] - before.values[c];
+		/* the fork and waitpid above are not part of the run */
+		total.values[COUNTER_FORKS] -= 1;
+		total.values[COUNTER_DIRECT_SYSCALLS] -= 2;
+	}
+
+	if (runs > 0)
+		bench_report(times, runs, &total);
+	command_free(command);
+	token_free_list(tokens);
+	free(source);
+	free(times);
+	return status;
+}
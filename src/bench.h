@@ -0,0 +1,9 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "shell.h"
+#include <stdio.h>
+
+int bench_run(ShellState *shell, FILE *stream, int runs);
+
+#endif
@@ -0,0 +1,799 @@
+#include "builtins.h"
+#include "input.h"
+#include "jobs.h"
+#include "metrics.h"
+#include "output.h"
+#include "test.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * builtin_escape - Writes one backslash escape sequence to standard output.
+ * @s: Pointer to the character following the backslash.
+ * @stop: Set to true if the sequence was \c.
+ *
+ * Return: Number of characters consumed after the backslash.
+ */
+static size_t builtin_escape(const char *s, bool *stop)
+{
+	size_t used = 1;
+	int value = 0;
+
+	switch (*s) {
+	case 'a':
+		output_putc(STDOUT_FILENO, '\a');
+		break;
+	case 'b':
+		output_putc(STDOUT_FILENO, '\b');
+		break;
+	case 'c':
+		*stop = true;
+		break;
+	case 'f':
+		output_putc(STDOUT_FILENO, '\f');
+		break;
+	case 'n':
+		output_putc(STDOUT_FILENO, '\n');
+		break;
+	case 'r':
+		output_putc(STDOUT_FILENO, '\r');
+		break;
+	case 't':
+		output_putc(STDOUT_FILENO, '\t');
+		break;
+	case 'v':
+		output_putc(STDOUT_FILENO, '\v');
+		break;
+	case '\\':
+		output_putc(STDOUT_FILENO, '\\');
+		break;
+	case '0':
+		while (used < 4 && s[used] >= '0' && s[used] <= '7')
+			value = value * 8 + (s[used++] - '0');
+		output_putc(STDOUT_FILENO, (char)value);
+		break;
+	case '\0':
+		output_putc(STDOUT_FILENO, '\\');
+		used = 0;
+		break;
+	default:
+		output_putc(STDOUT_FILENO, '\\');
+		output_putc(STDOUT_FILENO, *s);
+		break;
+	}
+	return used;
+}
+
+/**
+ * builtin_write_escaped - Writes a string, interpreting backslash escapes.
+ * @str: The string to write.
+ *
+ * Return: true if output should stop (\c was found), false otherwise.
+ */
+static bool builtin_write_escaped(const char *str)
+{
+	bool stop = false;
+
+	while (*str && !stop) {
+		size_t span = strcspn(str, "\\");
+
+		output_write(STDOUT_FILENO, str, span);
+		str += span;
+		if (*str == '\\')
+			str += 1 + builtin_escape(str + 1, &stop);
+	}
+	return stop;
+}
+
+/**
+ * builtin_echo - Writes its arguments to standard output.
+ * @shell: Pointer to the shell state.
+ * @argc: Number of arguments.
+ * @argv: Argument vector.
+ * Return: Always 0.
+ */
+static int builtin_echo(ShellState *shell, int argc, char **argv)
+{
+	bool newline = true;
+	int i = 1;
+
+	(void)shell;
+	if (i < argc && strcmp(argv[i], "-n") == 0) {
+		newline = false;
+		i++;
+	}
+
+	for (; i < argc; i++) {
+		if (builtin_write_escaped(argv[i]))
+			return 0;
+		if (i + 1 < argc)
+			output_putc(STDOUT_FILENO, ' ');
+	}
+	if (newline)
+		output_putc(STDOUT_FILENO, '\n');
+	return 0;
+}
+
+/**
+ * builtin_printf_number - Parses a numeric printf argument.
+ * @shell: Pointer to the shell state.
+ * @arg: The argument, or NULL if arguments are exhausted.
+ * @status: Set to 1 if the argument is not a valid number.
+ * Return: The parsed value.
+ */
+static long long builtin_printf_number(ShellState *shell, const char *arg,
+				       int *status)
+{
+	char *end;
+	long long value;
+
+	if (!arg || !*arg)
+		return 0;
+	if (arg[0] == '\'' || arg[0] == '"')
+		return (unsigned char)arg[1];
+
+	errno = 0;
+	value = strtoll(arg, &end, 0);
+	if (*end || errno) {
+		output_printf(STDERR_FILENO, "%s: %d: printf: %s: %s\n",
+			      shell->name, shell->line_number, arg,
+			      errno ? strerror(errno) :
+				      "not completely converted");
+		*status = 1;
+	}
+	return value;
+}
+
+/**
+ * builtin_printf - Writes formatted output to standard output.
+ * @shell: Pointer to the shell state.
+ * @argc: Number of arguments.
+ * @argv: Argument vector.
+ *
+ * The format is reused until every argument has been consumed.
+ *
+ * Return: 0 on success, 1 if an argument could not be converted.
+ */
+static int builtin_printf(ShellState *shell, int argc, char **argv)
+{
+	const char *format;
+	char **args;
+	int status = 0;
+
+	if (argc < 2) {
+		output_printf(STDERR_FILENO,
+			      "%s: %d: printf: usage: "
+			      "printf format [arg ...]\n",
+			      shell->name, shell->line_number);
+		return 2;
+	}
+	format = argv[1];
+	args = argv + 2;
+
+	do {
+		bool used_arg = false;
+
+		for (const char *f = format; *f; f++) {
+			if (*f == '\\') {
+				bool stop = false;
+				f += builtin_escape(f + 1, &stop);
+				if (stop)
+					return status;
+				continue;
+			}
+			if (*f != '%') {
+				size_t span = strcspn(f, "\\%");
+				output_write(STDOUT_FILENO, f, span);
+				f += span - 1;
+				continue;
+			}
+			if (f[1] == '%') {
+				output_putc(STDOUT_FILENO, '%');
+				f++;
+				continue;
+			}
+
+			char spec[32];
+			size_t len = 0;
+			spec[len++] = *f++;
+			while (*f && strchr("-+ #0123456789.", *f) &&
+			       len < sizeof(spec) - 4)
+				spec[len++] = *f++;
+			if (!*f)
+				break;
+
+			const char *arg = *args;
+			if (arg) {
+				args++;
+				used_arg = true;
+			}
+
+			switch (*f) {
+			case 'd':
+			case 'i':
+				spec[len++] = 'l';
+				spec[len++] = 'l';
+				spec[len++] = *f;
+				spec[len] = '\0';
+				output_printf(STDOUT_FILENO, spec,
+					      builtin_printf_number(shell, arg,
+								    &status));
+				break;
+			case 'u':
+			case 'o':
+			case 'x':
+			case 'X':
+				spec[len++] = 'l';
+				spec[len++] = 'l';
+				spec[len++] = *f;
+				spec[len] = '\0';
+				output_printf(STDOUT_FILENO, spec,
+					      (unsigned long long)
+						      builtin_printf_number(
+							      shell, arg,
+							      &status));
+				break;
+			case 'c':
+				if (arg && *arg)
+					output_putc(STDOUT_FILENO, *arg);
+				break;
+			case 'b':
+				if (arg && builtin_write_escaped(arg))
+					return status;
+				break;
+			case 's':
+				spec[len++] = 's';
+				spec[len] = '\0';
+				output_printf(STDOUT_FILENO, spec,
+					      arg ? arg : "");
+				break;
+			default:
+				output_printf(STDERR_FILENO,
+					      "%s: %d: printf: %%%c: "
+					      "invalid directive\n",
+					      shell->name, shell->line_number,
+					      *f);
+				return 1;
+			}
+		}
+		if (!used_arg)
+			break;
+	} while (*args);
+
+	return status;
+}
+
+/**
+ * builtin_exit - Exits the shell.
+ * @shell: Pointer to the shell state.
+ * @argc: Number of arguments.
+ * @argv: Argument vector.
+ * Return: The exit status requested.
+ */
+static int builtin_exit(ShellState *shell, int argc, char **argv)
+{
+	int status = shell->last_status;
+
+	if (argc > 1) {
+		char *end;
+		long value = strtol(argv[1], &end, 10);
+		if (*end || value < 0) {
+			output_printf(STDERR_FILENO,
+				      "%s: %d: exit: Illegal number: %s\n",
+				      shell->name, shell->line_number, argv[1]);
+			return 2;
+		}
+		status = (int)(value & 0xff);
+	}
+	shell->exit_requested = true;
+	return status;
+}
+
+/**
+ * builtin_cd - Changes the current working directory.
+ * @shell: Pointer to the shell state.
+ * @argc: Number of arguments.
+ * @argv: Argument vector.
+ * Return: 0 on success, 2 otherwise.
+ */
+static int builtin_cd(ShellState *shell, int argc, char **argv)
+{
+	const char *dir = argc > 1 ? argv[1] : var_get(&shell->vars, "HOME");
+	bool print = false;
+	char cwd[PATH_MAX];
+
+	if (dir && strcmp(dir, "-") == 0) {
+		dir = var_get(&shell->vars, "OLDPWD");
+		print = true;
+	}
+	if (!dir || !*dir)
+		return 0;
+
+	if (chdir(dir) < 0) {
+		output_printf(STDERR_FILENO, "%s: %d: cd: can't cd to %s\n",
+			      shell->name, shell->line_number, dir);
+		return 2;
+	}
+
+	const char *old = var_get(&shell->vars, "PWD");
+	if (old && !var_set(&shell->vars, "OLDPWD", old, true))
+		shell->fatal_error = true;
+	if (getcwd(cwd, sizeof(cwd))) {
+		if (!var_set(&shell->vars, "PWD", cwd, true))
+			shell->fatal_error = true;
+		if (print)
+			output_printf(STDOUT_FILENO, "%s\n", cwd);
+	}
+	return 0;
+}
+
+/**
+ * builtin_export - Sets and exports shell variables.
+ * @shell: Pointer to the shell state.
+ * @argc: Number of arguments.
+ * @argv: Argument vector.
+ *
+ * A bare name exports an existing variable, or creates an empty one.
+ *
+ * Return: 0 on success, 1 on allocation failure.
+ */
+static int builtin_export(ShellState *shell, int argc, char **argv)
+{
+	if (argc < 2) {
+		char **env = var_environ(&shell->vars);
+		for (; env && *env; env++)
+			output_printf(STDOUT_FILENO, "export %s\n", *env);
+		return 0;
+	}
+
+	for (int i = 1; i < argc; i++) {
+		bool ok;
+
+		if (strchr(argv[i], '='))
+			ok = var_assign(&shell->vars, argv[i], true);
+		else
+			ok = var_export(&shell->vars, argv[i]) ||
+			     var_set(&shell->vars, argv[i], "", true);
+		if (!ok) {
+			shell->fatal_error = true;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * builtin_metrics - Writes the shell's metrics in OpenMetrics text format.
+ * @shell: Pointer to the shell state.
+ * @argc: Number of arguments.
+ * @argv: Argument vector.
+ * Return: 0 on success, 1 on allocation failure.
+ */
+static int builtin_metrics(ShellState *shell, int argc, char **argv)
+{
+	size_t length;
+	char *text;
+
+	(void)argc;
+	(void)argv;
+	text = metrics_format(&length);
+	if (!text) {
+		output_printf(STDERR_FILENO, "Error: malloc failed\n");
+		shell->fatal_error = true;
+		return 1;
+	}
+	output_write(STDOUT_FILENO, text, length);
+	free(text);
+	return 0;
+}
+
+/**
+ * builtin_true - Does nothing, successfully; also used for ":".
+ * @shell: Pointer to the shell state.
+ * @argc: Number of arguments.
+ * @argv: Argument vector.
+ * Return: Always 0.
+ */
+static int builtin_true(ShellState *shell, int argc, char **argv)
+{
+	(void)shell;
+	(void)argc;
+	(void)argv;
+	return 0;
+}
+
+/**
+ * builtin_false - Does nothing, unsuccessfully.
+ * @shell: Pointer to the shell state.
+ * @argc: Number of arguments.
+ * @argv: Argument vector.
+ * Return: Always 1.
+ */
+static int builtin_false(ShellState *shell, int argc, char **argv)
+{
+	(void)shell;
+	(void)argc;
+	(void)argv;
+	return 1;
+}
+
+/**
+ * builtin_loop_count - Parses the level argument of break and continue.
+ * @shell: Pointer to the shell state.
+ * @argc: Number of arguments.
+ * @argv: Argument vector.
+ * Return: The number of enclosing loops affected, or -1 on error.
+ */
+static int builtin_loop_count(ShellState *shell, int argc, char **argv)
+{
+	long count = 1;
+
+	if (argc > 1) {
+		char *end;
+		count = strtol(argv[1], &end, 10);
+		if (*end || count < 1) {
+			output_printf(STDERR_FILENO,
+				      "%s: %d: %s: Illegal number: %s\n",
+				      shell->name, shell->line_number, argv[0],
+				      argv[1]);
+			return -1;
+		}
+	}
+	return count > shell->loop_depth ? shell->loop_depth : (int)count;
+}
+
+/**
+ * builtin_break - Exits from enclosing for, while or until loops.
+ * @shell: Pointer to the shell state.
+ * @argc: Number of arguments.
+ * @argv: Argument vector.
+ * Return: 0 on success, 2 on an invalid level.
+ */
+static int builtin_break(ShellState *shell, int argc, char **argv)
+{
+	int count = builtin_loop_count(shell, argc, argv);
+
+	if (count < 0)
+		return 2;
+	shell->break_count = count;
+	return 0;
+}
+
+/**
+ * builtin_continue - Starts the next iteration of an enclosing loop.
+ * @shell: Pointer to the shell state.
+ * @argc: Number of arguments.
+ * @argv: Argument vector.
+ * Return: 0 on success, 2 on an invalid level.
+ */
+static int builtin_continue(ShellState *shell, int argc, char **argv)
+{
+	int count = builtin_loop_count(shell, argc, argv);
+
+	if (count < 0)
+		return 2;
+	shell->continue_count = count;
+	return 0;
+}
+
+/**
+ * builtin_return - Returns from the running shell function.
+ * @shell: Pointer to the shell state.
+ * @argc: Number of arguments.
+ * @argv: Argument vector.
+ * Return: The status the function returns with.
+ */
+static int builtin_return(ShellState *shell, int argc, char **argv)
+{
+	int status = shell->last_status;
+
+	if (argc > 1) {
+		char *end;
+		long value = strtol(argv[1], &end, 10);
+		if (*end || value < 0) {
+			output_printf(STDERR_FILENO,
+				      "%s: %d: return: Illegal number: %s\n",
+				      shell->name, shell->line_number, argv[1]);
+			return 2;
+		}
+		status = (int)(value & 0xff);
+	}
+	if (shell->function_depth == 0) {
+		output_printf(STDERR_FILENO,
+			      "%s: %d: return: not in a function\n",
+			      shell->name, shell->line_number);
+		return 1;
+	}
+	shell->return_requested = true;
+	return status;
+}
+
+/**
+ * builtin_shift - Drops the first positional parameters.
+ * @shell: Pointer to the shell state.
+ * @argc: Number of arguments.
+ * @argv: Argument vector.
+ * Return: 0 on success, 2 if there are not enough parameters.
+ */
+static int builtin_shift(ShellState *shell, int argc, char **argv)
+{
+	long count = 1;
+
+	if (argc > 1) {
+		char *end;
+		count = strtol(argv[1], &end, 10);
+		if (*end || count < 0) {
+			output_printf(STDERR_FILENO,
+				      "%s: %d: shift: Illegal number: %s\n",
+				      shell->name, shell->line_number, argv[1]);
+			return 2;
+		}
+	}
+	if (count > shell->positional_count) {
+		output_printf(STDERR_FILENO,
+			      "%s: %d: shift: can't shift that many\n",
+			      shell->name, shell->line_number);
+		return 2;
+	}
+	shell->positional += count;
+	shell->positional_count -= count;
+	return 0;
+}
+
+/**
+ * builtin_wait - Waits for background jobs to finish.
+ * @shell: Pointer to the shell state.
+ * @argc: Number of arguments.
+ * @argv: Argument vector.
+ *
+ * Without operands every job is waited for, so their jobserver tokens are
+ * back in the pool before the next command starts.
+ *
+ * Return: The exit status of the last job named, 127 if it is not a job
+ *         of this shell, or 0 without operands.
+ */
+static int builtin_wait(ShellState *shell, int argc, char **argv)
+{
+	int status = 0;
+
+	if (argc < 2) {
+		job_reap(shell, true);
+		job_forget_done(shell);
+		return 0;
+	}
+	for (int i = 1; i < argc; i++) {
+		char *end;
+		long pid = strtol(argv[i], &end, 10);
+
+		if (*end || end == argv[i] || pid <= 0 || pid > INT_MAX) {
+			output_printf(STDERR_FILENO,
+				      "%s: %d: wait: Illegal number: %s\n",
+				      shell->name, shell->line_number, argv[i]);
+			return 2;
+		}
+		status = job_wait(shell, (pid_t)pid);
+	}
+	return status;
+}
+
+/**
+ * builtin_read_line - Reads a logical line for the read builtin.
+ * @line: The InputLine to read into.
+ * @raw: Do not treat backslash-newline as a line continuation.
+ * Return: 1 if a whole line was read, 0 at end of input, -1 on error.
+ */
+static int builtin_read_line(InputLine *line, bool raw)
+{
+	size_t scan = 0;
+
+	for (;;) {
+		int status = input_read_line(STDIN_FILENO, line);
+		if (status <= 0 || raw)
+			return status;
+
+		bool escaped = false;
+		for (size_t i = scan; i < line->length; i++)
+			escaped = !escaped && line->data[i] == '\\';
+		if (!escaped)
+			return status;
+		line->data[--line->length] = '\0';
+		scan = line->length;
+	}
+}
+
+/**
+ * builtin_read_unescape - Removes backslash escapes from a line.
+ * @line: The line, unescaped in place.
+ * @literal: Receives, per remaining character, whether it was escaped.
+ */
+static void builtin_read_unescape(InputLine *line, bool *literal)
+{
+	size_t out = 0;
+
+	for (size_t i = 0; i < line->length; i++) {
+		literal[out] = false;
+		if (line->data[i] == '\\' && i + 1 < line->length) {
+			i++;
+			literal[out] = true;
+		} else if (line->data[i] == '\\') {
+			continue;
+		}
+		line->data[out++] = line->data[i];
+	}
+	line->length = out;
+	line->data[out] = '\0';
+}
+
+/**
+ * builtin_read_is_ifs - Checks whether a character splits fields.
+ * @line: The line.
+ * @literal: Escaped-character mask, or NULL.
+ * @i: Index of the character.
+ * @ifs: The IFS value.
+ * @white: If true, only match IFS whitespace; otherwise only match other
+ *         IFS characters.
+ * Return: true if the character is a matching, unescaped IFS character.
+ */
+static bool builtin_read_is_ifs(const InputLine *line, const bool *literal,
+				size_t i, const char *ifs, bool white)
+{
+	char c = line->data[i];
+
+	if ((literal && literal[i]) || c == '\0' || !strchr(ifs, c))
+		return false;
+	return (c == ' ' || c == '\t' || c == '\n') == white;
+}
+
+/**
+ * builtin_read - Reads a line from standard input into variables.
+ * @shell: Pointer to the shell state.
+ * @argc: Number of arguments.
+ * @argv: Argument vector.
+ *
+ * The line is split into fields using IFS; the last variable receives the
+ * rest of the line. Without -r, backslash escapes the next character and
+ * backslash-newline continues the line. With no names, REPLY is set.
+ *
+ * Return: 0 on success, 1 at end of input or on error, 2 on bad usage.
+ */
+static int builtin_read(ShellState *shell, int argc, char **argv)
+{
+	bool raw = false;
+	int first = 1;
+
+	for (; first < argc && argv[first][0] == '-' && argv[first][1];
+	     first++) {
+		if (strcmp(argv[first], "--") == 0) {
+			first++;
+			break;
+		}
+		if (strcmp(argv[first], "-r") != 0) {
+			output_printf(STDERR_FILENO,
+				      "%s: %d: read: Illegal option %s\n",
+				      shell->name, shell->line_number,
+				      argv[first]);
+			return 2;
+		}
+		raw = true;
+	}
+
+	/* prompts written before read must be visible while it blocks */
+	output_flush_all();
+
+	InputLine line = { 0 };
+	bool *literal = NULL;
+	int status = builtin_read_line(&line, raw);
+	if (status < 0) {
+		output_printf(STDERR_FILENO, "%s: %d: read: %s\n", shell->name,
+			      shell->line_number, strerror(errno));
+		free(line.data);
+		return 1;
+	}
+	if (!raw) {
+		literal = malloc(line.length + 1);
+		if (!literal) {
+			free(line.data);
+			shell->fatal_error = true;
+			return 1;
+		}
+		builtin_read_unescape(&line, literal);
+	}
+
+	const char *ifs = var_get(&shell->vars, "IFS");
+	if (!ifs)
+		ifs = " \t\n";
+
+	char *reply[] = { "REPLY" };
+	char **names = first < argc ? argv + first : reply;
+	int count = first < argc ? argc - first : 1;
+	size_t pos = 0;
+	bool ok = true;
+
+	for (int n = 0; n < count && ok; n++) {
+		while (pos < line.length &&
+		       builtin_read_is_ifs(&line, literal, pos, ifs, true))
+			pos++;
+
+		size_t start = pos;
+		size_t end;
+		if (n == count - 1) {
+			end = line.length;
+			while (end > start &&
+			       builtin_read_is_ifs(&line, literal, end - 1, ifs,
+						   true))
+				end--;
+			pos = line.length;
+		} else {
+			while (pos < line.length &&
+			       !builtin_read_is_ifs(&line, literal, pos, ifs,
+						    true) &&
+			       !builtin_read_is_ifs(&line, literal, pos, ifs,
+						    false))
+				pos++;
+			end = pos;
+			while (pos < line.length &&
+			       builtin_read_is_ifs(&line, literal, pos, ifs,
+						   true))
+				pos++;
+			if (pos < line.length &&
+			    builtin_read_is_ifs(&line, literal, pos, ifs,
+						false))
+				pos++;
+		}
+
+		char saved = line.data[end];
+		line.data[end] = '\0';
+		ok = var_set(&shell->vars, names[n], line.data + start, false);
+		line.data[end] = saved;
+	}
+
+	free(literal);
+	free(line.data);
+	if (!ok) {
+		shell->fatal_error = true;
+		return 1;
+	}
+	return status == 1 ? 0 : 1;
+}
+
+/*
+ * stateless builtins change nothing in the shell but its output; the
+ * assignments in front of special builtins stay set after them
+ */
+static const Builtin builtins[] = {
+	{ ":", builtin_true, true, true },
+	{ "[", test_command, true, false },
+	{ "break", builtin_break, false, true },
+	{ "cd", builtin_cd, false, false },
+	{ "continue", builtin_continue, false, true },
+	{ "echo", builtin_echo, true, false },
+	{ "exit", builtin_exit, false, true },
+	{ "export", builtin_export, false, true },
+	{ "false", builtin_false, true, false },
+	{ "metrics", builtin_metrics, true, false },
+	{ "printf", builtin_printf, true, false },
+	{ "read", builtin_read, false, false },
+	{ "return", builtin_return, false, true },
+	{ "shift", builtin_shift, false, true },
+	{ "test", test_command, true, false },
+	{ "true", builtin_true, true, false },
+	{ "wait", builtin_wait, false, false },
+};
+
+/**
+ * builtin_lookup - Finds a builtin command by name.
+ * @name: The command name.
+ * Return: Pointer to the Builtin, or NULL if the name is not a builtin.
+ */
+const Builtin *builtin_lookup(const char *name)
+{
+	for (size_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); i++) {
+		if (strcmp(builtins[i].name, name) == 0)
+			return &builtins[i];
+	}
+	return NULL;
+}
@@ -0,0 +1,17 @@
+#ifndef BUILTINS_H
+#define BUILTINS_H
+
+#include "shell.h"
+
+typedef int (*BuiltinFunc)(ShellState *shell, int argc, char **argv);
+
+typedef struct Builtin {
+	const char *name;
+	BuiltinFunc func;
+	bool stateless;
+	bool special;
+} Builtin;
+
+const Builtin *builtin_lookup(const char *name);
+
+#endif
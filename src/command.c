@@ -1,17 +1,100 @@
 #include "command.h"
+#include "arith.h"
+#include "intern.h"
+#include "pattern.h"
 #include <stdlib.h>
 
+/**
+ * command_free_words - Frees a NULL-terminated array of interned strings.
+ * @words: The array, may be NULL.
+ */
+static void command_free_words(char **words)
+{
+	if (words == NULL)
+		return;
+	for (char **word = words; *word; word++)
+		intern_release(*word);
+	free(words);
+}
+
+/**
+ * command_free_simple - Frees the strings owned by a simple command.
+ * @simple: Pointer to the SimpleCommand structure.
+ */
+static void command_free_simple(SimpleCommand *simple)
+{
+	command_free_words(simple->argv);
+	command_free_words(simple->envp);
+	for (int i = 0; i < simple->redirect_count; i++)
+		intern_release(simple->redirects[i].word);
+	free(simple->redirects);
+	arith_free_list(simple->arith);
+}
+
+/**
+ * command_free - Frees a command tree and the strings it owns.
+ * @command: Pointer to the Command structure, may be NULL.
+ *
+ * A function definition is shared with the function table, so it is only
+ * freed once its last reference is dropped.
+ */
 void command_free(Command *command)
 {
 	if (command == NULL)
 		return;
 
-	if (command->type == CMD_SIMPLE) {
-		free(command->as.command.argv);
-		free(command->as.command.envp);
-	} else {
+	switch (command->type) {
+	case CMD_SIMPLE:
+		command_free_simple(&command->as.command);
+		break;
+	case CMD_TIME:
+		command_free(command->as.timed.body);
+		break;
+	case CMD_IF:
+		command_free(command->as.if_clause.condition);
+		command_free(command->as.if_clause.then_part);
+		command_free(command->as.if_clause.else_part);
+		break;
+	case CMD_WHILE:
+	case CMD_UNTIL:
+		command_free(command->as.loop.condition);
+		command_free(command->as.loop.body);
+		break;
+	case CMD_FOR:
+		intern_release(command->as.for_clause.name);
+		command_free_words(command->as.for_clause.words);
+		command_free(command->as.for_clause.body);
+		arith_free_list(command->as.for_clause.arith);
+		break;
+	case CMD_CASE:
+		for (int i = 0; i < command->as.case_clause.arm_count; i++) {
+			CaseArm *arm = &command->as.case_clause.arms[i];
+			command_free_words(arm->patterns);
+			command_free(arm->body);
+		}
+		free(command->as.case_clause.arms);
+		intern_release(command->as.case_clause.word);
+		pattern_set_free(command->as.case_clause.patterns);
+		arith_free_list(command->as.case_clause.arith);
+		break;
+	case CMD_GROUP:
+	case CMD_SUBSHELL:
+		command_free(command->as.group.body);
+		break;
+	case CMD_FUNCTION:
+		if (--command->as.function.refs > 0)
+			return;
+		intern_release(command->as.function.name);
+		command_free(command->as.function.body);
+		break;
+	default:
 		command_free(command->as.binary.left);
 		command_free(command->as.binary.right);
+		break;
+	}
+	if (command->redirect) {
+		command_free_simple(command->redirect);
+		free(command->redirect);
 	}
 	free(command);
 }
@@ -3,32 +3,110 @@
 
 #include <stdbool.h>
 
+struct Arith;
+struct PatternSet;
+
 typedef enum {
 	CMD_SIMPLE,
 	CMD_PIPE,
 	CMD_AND,
 	CMD_OR,
 	CMD_SEPARATOR,
+	CMD_TIME,
+	CMD_IF,
+	CMD_WHILE,
+	CMD_UNTIL,
+	CMD_FOR,
+	CMD_CASE,
+	CMD_GROUP,
+	CMD_SUBSHELL,
+	CMD_FUNCTION,
 } CommandType;
 
+/* highest descriptor a redirection may name, as in "9>&1" */
+#define REDIRECT_MAX_FD 9
+
+typedef enum {
+	REDIRECT_FILE,
+	REDIRECT_DUP,
+	REDIRECT_CLOSE,
+} RedirectType;
+
+typedef struct Redirect {
+	RedirectType type;
+	int fd;
+	/* open(2) flags of a REDIRECT_FILE */
+	int flags;
+	/* descriptor copied by a REDIRECT_DUP, or -1 until @word expands */
+	int source;
+	/* file name, or the expansion naming the source; NULL otherwise */
+	char *word;
+} Redirect;
+
 typedef struct SimpleCommand {
 	int argc;
 	char **argv;
 	char **envp;
-	char *input_file;
-	char *output_file;
-	bool append_output;
+	Redirect *redirects;
+	int redirect_count;
+	bool needs_expansion;
+	struct Arith *arith;
 } SimpleCommand;
 
+typedef struct CaseArm {
+	char **patterns;
+	int pattern_count;
+	struct Command *body;
+} CaseArm;
+
 typedef struct Command {
 	CommandType type;
 	bool is_background;
+	/* redirections of a compound command, as a simple command with no
+	 * words; NULL if there are none */
+	SimpleCommand *redirect;
 	union {
 		SimpleCommand command;
 		struct {
 			struct Command *left;
 			struct Command *right;
 		} binary;
+		struct {
+			struct Command *body;
+			bool posix_format;
+		} timed;
+		struct {
+			struct Command *condition;
+			struct Command *then_part;
+			struct Command *else_part;
+		} if_clause;
+		struct {
+			struct Command *condition;
+			struct Command *body;
+		} loop;
+		struct {
+			char *name;
+			char **words;
+			int word_count;
+			bool has_in;
+			struct Command *body;
+			struct Arith *arith;
+		} for_clause;
+		struct {
+			char *word;
+			CaseArm *arms;
+			int arm_count;
+			struct PatternSet *patterns;
+			struct Arith *arith;
+		} case_clause;
+		struct {
+			struct Command *body;
+		} group;
+		struct {
+			char *name;
+			struct Command *body;
+			int refs;
+		} function;
 	} as;
 } Command;
 
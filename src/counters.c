@@ -0,0 +1,478 @@
+#define _GNU_SOURCE
+
+#include "counters.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*
+ * The Makefile links the shell with -Wl,--wrap for the allocation and
+ * system call functions below, so that every call made by the shell's own
+ * code goes through a __wrap_ function that counts it before calling the
+ * __real_ one. Every system call wrapper the shell calls directly is in
+ * the list. Calls made inside the C library, such as the reads behind
+ * getline or the writes behind fprintf, are not seen; hence the name
+ * "direct_syscalls".
+ *
+ * Every update is a relaxed atomic add, cheap enough to leave on.
+ */
+
+static const char *const counter_names[COUNTER_COUNT] = {
+	"forks",
+	"execs",
+	"direct_syscalls",
+	"allocations",
+	"allocated_bytes",
+	"lines",
+	"parse_errors",
+	"spawns",
+	"spawn_ns",
+	"builtins",
+	"jobs_started",
+	"jobs_finished",
+	"path_found",
+	"path_not_found",
+};
+
+/* upper bounds of the spawn latency buckets in nanoseconds; -1 is +Inf */
+static const long long latency_bounds[COUNTER_LATENCY_BUCKETS] = {
+	25000, 50000, 100000, 250000, 500000,
+	1000000, 2500000, 5000000, 10000000, -1,
+};
+
+static Counters local_counters;
+static Counters *counters = &local_counters;
+
+/**
+ * counters_share - Moves the counters to memory shared with children.
+ *
+ * Afterwards, forked children add to the same counters as the shell, so
+ * the work done by subshells and pipeline stages is seen by the parent.
+ *
+ * Return: true on success, false if the memory cannot be mapped.
+ */
+bool counters_share(void)
+{
+	Counters *shared;
+
+	if (counters != &local_counters)
+		return true;
+	shared = mmap(NULL, sizeof(Counters), PROT_READ | PROT_WRITE,
+		      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED)
+		return false;
+	memcpy(shared, &local_counters, sizeof(Counters));
+	counters = shared;
+	return true;
+}
+
+/**
+ * counters_snapshot - Copies the current counter values.
+ * @out: Where to store the values.
+ */
+void counters_snapshot(Counters *out)
+{
+	for (int i = 0; i < COUNTER_COUNT; i++)
+		out->values[i] = __atomic_load_n(&counters->values[i],
+						 __ATOMIC_RELAXED);
+	for (int i = 0; i < COUNTER_LATENCY_BUCKETS; i++)
+		out->spawn_latency[i] = __atomic_load_n(
+			&counters->spawn_latency[i], __ATOMIC_RELAXED);
+}
+
+/**
+ * counter_add - Adds to a counter.
+ * @id: The counter.
+ * @n: The amount to add.
+ */
+void counter_add(CounterId id, unsigned long n)
+{
+	__atomic_fetch_add(&counters->values[id], n, __ATOMIC_RELAXED);
+}
+
+/**
+ * counter_observe_spawn - Records the time taken to start a process.
+ * @nanoseconds: Time spent in fork, as seen by the parent.
+ */
+void counter_observe_spawn(long long nanoseconds)
+{
+	int bucket = 0;
+
+	while (latency_bounds[bucket] >= 0 &&
+	       nanoseconds > latency_bounds[bucket])
+		bucket++;
+	counter_add(COUNTER_SPAWNS, 1);
+	counter_add(COUNTER_SPAWN_NANOSECONDS, nanoseconds);
+	__atomic_fetch_add(&counters->spawn_latency[bucket], 1,
+			   __ATOMIC_RELAXED);
+}
+
+/**
+ * counter_latency_bound - Returns the upper bound of a latency bucket.
+ * @bucket: The bucket index.
+ * Return: The bound in nanoseconds, or -1 for the last, unbounded one.
+ */
+long long counter_latency_bound(int bucket)
+{
+	return latency_bounds[bucket];
+}
+
+/**
+ * counter_name - Returns the name of a counter.
+ * @id: The counter.
+ * Return: The name, for reports.
+ */
+const char *counter_name(CounterId id)
+{
+	return counter_names[id];
+}
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+char *__real_strdup(const char *s);
+char *__real_strndup(const char *s, size_t n);
+pid_t __real_fork(void);
+int __real_execve(const char *path, char *const argv[], char *const envp[]);
+ssize_t __real_read(int fd, void *buf, size_t count);
+ssize_t __real_write(int fd, const void *buf, size_t count);
+int __real_open(const char *path, int flags, ...);
+int __real_close(int fd);
+int __real_pipe(int fds[2]);
+int __real_pipe2(int fds[2], int flags);
+int __real_dup2(int oldfd, int newfd);
+pid_t __real_wait4(pid_t pid, int *status, int options, struct rusage *usage);
+pid_t __real_waitpid(pid_t pid, int *status, int options);
+int __real_stat(const char *path, struct stat *st);
+int __real_fstat(int fd, struct stat *st);
+int __real_fstatat(int dirfd, const char *path, struct stat *st, int flags);
+off_t __real_lseek(int fd, off_t offset, int whence);
+int __real_access(const char *path, int mode);
+int __real_faccessat(int dirfd, const char *path, int mode, int flags);
+int __real_chdir(const char *path);
+ssize_t __real_recv(int fd, void *buf, size_t size, int flags);
+ssize_t __real_tee(int in, int out, size_t size, unsigned int flags);
+int __real_fcntl(int fd, int cmd, ...);
+int __real_poll(struct pollfd *fds, nfds_t count, int timeout);
+int __real_dup(int fd);
+int __real_sigaction(int sig, const struct sigaction *sa,
+		     struct sigaction *old);
+int __real_pthread_sigmask(int how, const sigset_t *set, sigset_t *old);
+int __real_isatty(int fd);
+int __real_getrusage(int who, struct rusage *usage);
+int __real_getgroups(int size, gid_t *list);
+uid_t __real_geteuid(void);
+gid_t __real_getegid(void);
+pid_t __real_getpid(void);
+int __real_unlink(const char *path);
+int __real_rename(const char *from, const char *to);
+int __real_mkostemp(char *template, int flags);
+void *__real_mmap(void *addr, size_t length, int prot, int flags, int fd,
+		  off_t offset);
+char *__real_getcwd(char *buf, size_t size);
+long __real_syscall(long number, ...);
+
+void *__wrap_malloc(size_t size)
+{
+	counter_add(COUNTER_ALLOCATIONS, 1);
+	counter_add(COUNTER_ALLOCATED_BYTES, size);
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+	counter_add(COUNTER_ALLOCATIONS, 1);
+	counter_add(COUNTER_ALLOCATED_BYTES, count * size);
+	return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+	counter_add(COUNTER_ALLOCATIONS, 1);
+	counter_add(COUNTER_ALLOCATED_BYTES, size);
+	return __real_realloc(ptr, size);
+}
+
+char *__wrap_strdup(const char *s)
+{
+	counter_add(COUNTER_ALLOCATIONS, 1);
+	counter_add(COUNTER_ALLOCATED_BYTES, strlen(s) + 1);
+	return __real_strdup(s);
+}
+
+char *__wrap_strndup(const char *s, size_t n)
+{
+	counter_add(COUNTER_ALLOCATIONS, 1);
+	counter_add(COUNTER_ALLOCATED_BYTES, strnlen(s, n) + 1);
+	return __real_strndup(s, n);
+}
+
+pid_t __wrap_fork(void)
+{
+	pid_t pid = __real_fork();
+
+	/* counted once, by the parent */
+	if (pid > 0)
+		counter_add(COUNTER_FORKS, 1);
+	if (pid != 0)
+		counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return pid;
+}
+
+int __wrap_execve(const char *path, char *const argv[], char *const envp[])
+{
+	counter_add(COUNTER_EXECS, 1);
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_execve(path, argv, envp);
+}
+
+ssize_t __wrap_read(int fd, void *buf, size_t count)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_read(fd, buf, count);
+}
+
+ssize_t __wrap_write(int fd, const void *buf, size_t count)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_write(fd, buf, count);
+}
+
+int __wrap_open(const char *path, int flags, ...)
+{
+	mode_t mode = 0;
+
+	if (flags & (O_CREAT | O_TMPFILE)) {
+		va_list args;
+		va_start(args, flags);
+		mode = va_arg(args, mode_t);
+		va_end(args);
+	}
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_open(path, flags, mode);
+}
+
+int __wrap_close(int fd)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_close(fd);
+}
+
+int __wrap_pipe(int fds[2])
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_pipe(fds);
+}
+
+int __wrap_pipe2(int fds[2], int flags)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_pipe2(fds, flags);
+}
+
+int __wrap_dup2(int oldfd, int newfd)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_dup2(oldfd, newfd);
+}
+
+pid_t __wrap_wait4(pid_t pid, int *status, int options, struct rusage *usage)
+{
+	pid_t result = __real_wait4(pid, status, options, usage);
+
+	/* counted on return, once the child's own counts are in */
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return result;
+}
+
+pid_t __wrap_waitpid(pid_t pid, int *status, int options)
+{
+	pid_t result = __real_waitpid(pid, status, options);
+
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return result;
+}
+
+int __wrap_stat(const char *path, struct stat *st)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_stat(path, st);
+}
+
+int __wrap_fstat(int fd, struct stat *st)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_fstat(fd, st);
+}
+
+int __wrap_fstatat(int dirfd, const char *path, struct stat *st, int flags)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_fstatat(dirfd, path, st, flags);
+}
+
+off_t __wrap_lseek(int fd, off_t offset, int whence)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_lseek(fd, offset, whence);
+}
+
+int __wrap_access(const char *path, int mode)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_access(path, mode);
+}
+
+int __wrap_faccessat(int dirfd, const char *path, int mode, int flags)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_faccessat(dirfd, path, mode, flags);
+}
+
+int __wrap_chdir(const char *path)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_chdir(path);
+}
+
+ssize_t __wrap_recv(int fd, void *buf, size_t size, int flags)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_recv(fd, buf, size, flags);
+}
+
+ssize_t __wrap_tee(int in, int out, size_t size, unsigned int flags)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_tee(in, out, size, flags);
+}
+
+int __wrap_fcntl(int fd, int cmd, ...)
+{
+	va_list args;
+	void *arg;
+
+	/* like the C library, pass on one argument whatever the command */
+	va_start(args, cmd);
+	arg = va_arg(args, void *);
+	va_end(args);
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_fcntl(fd, cmd, arg);
+}
+
+int __wrap_poll(struct pollfd *fds, nfds_t count, int timeout)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_poll(fds, count, timeout);
+}
+
+int __wrap_dup(int fd)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_dup(fd);
+}
+
+int __wrap_sigaction(int sig, const struct sigaction *sa,
+		     struct sigaction *old)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_sigaction(sig, sa, old);
+}
+
+int __wrap_pthread_sigmask(int how, const sigset_t *set, sigset_t *old)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_pthread_sigmask(how, set, old);
+}
+
+int __wrap_isatty(int fd)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_isatty(fd);
+}
+
+int __wrap_getrusage(int who, struct rusage *usage)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_getrusage(who, usage);
+}
+
+int __wrap_getgroups(int size, gid_t *list)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_getgroups(size, list);
+}
+
+uid_t __wrap_geteuid(void)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_geteuid();
+}
+
+gid_t __wrap_getegid(void)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_getegid();
+}
+
+pid_t __wrap_getpid(void)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_getpid();
+}
+
+int __wrap_unlink(const char *path)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_unlink(path);
+}
+
+int __wrap_rename(const char *from, const char *to)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_rename(from, to);
+}
+
+int __wrap_mkostemp(char *template, int flags)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_mkostemp(template, flags);
+}
+
+void *__wrap_mmap(void *addr, size_t length, int prot, int flags, int fd,
+		  off_t offset)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_mmap(addr, length, prot, flags, fd, offset);
+}
+
+char *__wrap_getcwd(char *buf, size_t size)
+{
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_getcwd(buf, size);
+}
+
+long __wrap_syscall(long number, ...)
+{
+	va_list args;
+	long arg[6];
+
+	/* the kernel takes at most six arguments; pass on that many */
+	va_start(args, number);
+	for (int i = 0; i < 6; i++)
+		arg[i] = va_arg(args, long);
+	va_end(args);
+	counter_add(COUNTER_DIRECT_SYSCALLS, 1);
+	return __real_syscall(number, arg[0], arg[1], arg[2], arg[3], arg[4],
+			      arg[5]);
+}
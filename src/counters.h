@@ -0,0 +1,38 @@
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <stdbool.h>
+
+typedef enum CounterId {
+	COUNTER_FORKS,
+	COUNTER_EXECS,
+	COUNTER_DIRECT_SYSCALLS,
+	COUNTER_ALLOCATIONS,
+	COUNTER_ALLOCATED_BYTES,
+	COUNTER_LINES,
+	COUNTER_PARSE_ERRORS,
+	COUNTER_SPAWNS,
+	COUNTER_SPAWN_NANOSECONDS,
+	COUNTER_BUILTINS,
+	COUNTER_JOBS_STARTED,
+	COUNTER_JOBS_FINISHED,
+	COUNTER_PATH_FOUND,
+	COUNTER_PATH_NOT_FOUND,
+	COUNTER_COUNT,
+} CounterId;
+
+#define COUNTER_LATENCY_BUCKETS 10
+
+typedef struct Counters {
+	unsigned long values[COUNTER_COUNT];
+	unsigned long spawn_latency[COUNTER_LATENCY_BUCKETS];
+} Counters;
+
+bool counters_share(void);
+void counters_snapshot(Counters *out);
+void counter_add(CounterId id, unsigned long n);
+void counter_observe_spawn(long long nanoseconds);
+long long counter_latency_bound(int bucket);
+const char *counter_name(CounterId id);
+
+#endif
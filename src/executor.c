@@ -1,8 +1,1559 @@
 #include "executor.h"
+#include "builtins.h"
+#include "counters.h"
+#include "expand.h"
+#include "intern.h"
+#include "jobs.h"
+#include "output.h"
+#include "pattern.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
 
-int execute_command(Command *command)
+/* marks a descriptor executor_redirect_shell has not touched */
+#define EXECUTOR_UNSAVED -2
+
+typedef struct ExecutorSaved {
+	bool active;
+	int fds[REDIRECT_MAX_FD + 1];
+} ExecutorSaved;
+
+static int executor_run(ShellState *shell, Command *command);
+
+/**
+ * executor_find_path - Resolves a command name using the PATH variable.
+ * @shell: Pointer to the shell state.
+ * @name: The command name.
+ *
+ * Return: Newly allocated path of the executable, or NULL if not found.
+ */
+static char *executor_find_path(ShellState *shell, const char *name)
+{
+	const char *path = var_get(&shell->vars, "PATH");
+	size_t name_len = strlen(name);
+
+	if (strchr(name, '/'))
+		return strdup(name);
+	if (!path)
+		path = "/usr/local/bin:/usr/bin:/bin";
+
+	while (true) {
+		size_t dir_len = strcspn(path, ":");
+		char *candidate = malloc(dir_len + name_len + 2);
+		struct stat st;
+
+		if (!candidate)
+			return NULL;
+		if (dir_len == 0) {
+			memcpy(candidate, name, name_len + 1);
+		} else {
+			memcpy(candidate, path, dir_len);
+			candidate[dir_len] = '/';
+			memcpy(candidate + dir_len + 1, name, name_len + 1);
+		}
+		if (stat(candidate, &st) == 0 && S_ISREG(st.st_mode) &&
+		    access(candidate, X_OK) == 0)
+			return candidate;
+		free(candidate);
+
+		if (path[dir_len] == '\0')
+			return NULL;
+		path += dir_len + 1;
+	}
+}
+
+/**
+ * execute_wait_status - Converts a wait status into a shell exit status.
+ * @status: The status returned by waitpid.
+ * Return: The exit status of the process.
+ */
+int execute_wait_status(int status)
+{
+	if (WIFEXITED(status))
+		return WEXITSTATUS(status);
+	if (WIFSIGNALED(status))
+		return 128 + WTERMSIG(status);
+	return 1;
+}
+
+/**
+ * executor_wait - Waits for a specific child process.
+ * @shell: Pointer to the shell state.
+ * @pid: Process ID of the child.
+ *
+ * While a "time" command is running, the resource usage of the child is
+ * added to shell->child_usage; peak RSS is summed over the children.
+ *
+ * Return: The exit status of the child.
+ */
+static int executor_wait(ShellState *shell, pid_t pid)
+{
+	struct rusage usage;
+	int status;
+
+	while (wait4(pid, &status, 0, &usage) < 0) {
+		if (errno != EINTR)
+			return 1;
+	}
+
+	if (shell->child_usage) {
+		struct rusage *total = shell->child_usage;
+		timeradd(&total->ru_utime, &usage.ru_utime, &total->ru_utime);
+		timeradd(&total->ru_stime, &usage.ru_stime, &total->ru_stime);
+		total->ru_maxrss += usage.ru_maxrss;
+	}
+	return execute_wait_status(status);
+}
+
+/**
+ * executor_fork - Forks after flushing buffered output.
+ *
+ * The time the parent spends in fork is recorded as the spawn latency.
+ *
+ * Return: The value returned by fork.
+ */
+static pid_t executor_fork(void)
+{
+	struct timespec start, end;
+	pid_t pid;
+
+	output_flush_all();
+	fflush(NULL);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	pid = fork();
+	if (pid > 0) {
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		counter_observe_spawn((end.tv_sec - start.tv_sec) *
+					      1000000000LL +
+				      (end.tv_nsec - start.tv_nsec));
+	}
+	return pid;
+}
+
+/**
+ * executor_child_exit - Flushes buffered output and exits a child process.
+ * @status: The exit status.
+ */
+static __attribute__((noreturn)) void executor_child_exit(int status)
+{
+	output_flush_all();
+	_exit(status);
+}
+
+/**
+ * executor_resolve_dup - Resolves a ">&" target known only once expanded.
+ * @shell: Pointer to the shell state.
+ * @redirect: The REDIRECT_DUP redirection, with its expanded word.
+ * Return: true on success, false if the word names no descriptor.
+ */
+static bool executor_resolve_dup(ShellState *shell, Redirect *redirect)
+{
+	const char *word = redirect->word;
+
+	if (strcmp(word, "-") == 0) {
+		redirect->type = REDIRECT_CLOSE;
+		return true;
+	}
+	if (word[0] >= '0' && word[0] <= '9' && word[1] == '\0') {
+		redirect->source = word[0] - '0';
+		return true;
+	}
+	output_printf(STDERR_FILENO, "%s: %d: %s: Bad fd number\n", shell->name,
+		      shell->line_number, word);
+	return false;
+}
+
+/**
+ * executor_apply_redirect - Applies one redirection.
+ * @shell: Pointer to the shell state.
+ * @redirect: The redirection, with its word expanded.
+ *
+ * Files are opened close-on-exec and only the copy made onto the target
+ * descriptor is inherited, so nothing opened here leaks into children.
+ *
+ * Return: true on success, false otherwise.
+ */
+static bool executor_apply_redirect(ShellState *shell, Redirect *redirect)
+{
+	int fd;
+
+	switch (redirect->type) {
+	case REDIRECT_FILE:
+		fd = open(redirect->word, redirect->flags | O_CLOEXEC, 0666);
+		if (fd < 0) {
+			output_printf(STDERR_FILENO,
+				      "%s: %d: cannot open %s: %s\n",
+				      shell->name, shell->line_number,
+				      redirect->word, strerror(errno));
+			return false;
+		}
+		if (fd == redirect->fd)
+			return fcntl(fd, F_SETFD, 0) == 0;
+		if (dup2(fd, redirect->fd) < 0) {
+			close(fd);
+			return false;
+		}
+		close(fd);
+		return true;
+	case REDIRECT_DUP:
+		if (redirect->source < 0 &&
+		    !executor_resolve_dup(shell, redirect))
+			return false;
+		if (redirect->type == REDIRECT_CLOSE)
+			break;
+		if (redirect->source == redirect->fd
+			    ? fcntl(redirect->fd, F_GETFD) >= 0
+			    : dup2(redirect->source, redirect->fd) >= 0)
+			return true;
+		output_printf(STDERR_FILENO, "%s: %d: %d: %s\n", shell->name,
+			      shell->line_number, redirect->source,
+			      strerror(errno));
+		return false;
+	case REDIRECT_CLOSE:
+		break;
+	}
+	close(redirect->fd);
+	return true;
+}
+
+/**
+ * executor_apply_redirections - Applies the redirections of a command.
+ * @shell: Pointer to the shell state.
+ * @simple: Pointer to the expanded SimpleCommand structure.
+ * Return: true on success, false if a redirection failed.
+ */
+static bool executor_apply_redirections(ShellState *shell,
+					SimpleCommand *simple)
+{
+	for (int i = 0; i < simple->redirect_count; i++) {
+		if (!executor_apply_redirect(shell, &simple->redirects[i]))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * executor_free_expanded - Frees a command built by executor_expand_simple.
+ * @simple: Pointer to the expanded SimpleCommand structure.
+ */
+static void executor_free_expanded(SimpleCommand *simple)
+{
+	for (int i = 0; i < simple->argc; i++)
+		free(simple->argv[i]);
+	free(simple->argv);
+	if (simple->envp) {
+		for (char **env = simple->envp; *env; env++)
+			free(*env);
+		free(simple->envp);
+	}
+	for (int i = 0; i < simple->redirect_count; i++)
+		free(simple->redirects[i].word);
+	free(simple->redirects);
+}
+
+/**
+ * executor_expand_simple - Expands the words of a simple command.
+ * @shell: Pointer to the shell state.
+ * @simple: Pointer to the SimpleCommand structure as parsed.
+ * @out: Receives a copy in which every string is newly allocated.
+ *
+ * Arguments undergo field splitting; assignments and redirection targets
+ * are expanded as single words. Arithmetic compiled on the way is cached
+ * in @simple, so a command run in a loop compiles it only once.
+ *
+ * Return: true on success, false on failure.
+ */
+static bool executor_expand_simple(ShellState *shell, SimpleCommand *simple,
+				   SimpleCommand *out)
+{
+	WordList argv = { NULL, 0, 0 };
+	WordList envp = { NULL, 0, 0 };
+	bool ok = true;
+
+	*out = *simple;
+	out->redirects = NULL;
+	out->redirect_count = 0;
+	out->needs_expansion = false;
+
+	for (int i = 0; ok && i < simple->argc; i++)
+		ok = expand_fields(shell, simple->argv[i], &argv,
+				   &simple->arith);
+	for (char **env = simple->envp; ok && *env; env++)
+		ok = word_list_append(&envp, expand_word(shell, *env,
+							 &simple->arith));
+	if (ok && !argv.items)
+		ok = (argv.items = calloc(1, sizeof(char *))) != NULL;
+	if (ok && !envp.items)
+		ok = (envp.items = calloc(1, sizeof(char *))) != NULL;
+	if (ok && simple->redirect_count > 0) {
+		out->redirects = malloc(sizeof(Redirect) *
+					simple->redirect_count);
+		ok = out->redirects != NULL;
+	}
+	for (int i = 0; ok && i < simple->redirect_count; i++) {
+		Redirect *redirect = &out->redirects[out->redirect_count++];
+
+		*redirect = simple->redirects[i];
+		if (!redirect->word)
+			continue;
+		redirect->word = expand_word(shell, redirect->word,
+					     &simple->arith);
+		ok = redirect->word != NULL;
+	}
+
+	out->argc = argv.count;
+	out->argv = argv.items;
+	out->envp = envp.items;
+	if (ok)
+		return true;
+
+	executor_free_expanded(out);
+	/* arithmetic errors have been reported already */
+	if (!shell->had_error) {
+		shell->fatal_error = true;
+		output_printf(STDERR_FILENO, "Error: malloc failed\n");
+	}
+	return false;
+}
+
+/**
+ * executor_find_function - Finds the function a simple command calls.
+ * @shell: Pointer to the shell state.
+ * @simple: Pointer to the SimpleCommand structure, with a command name.
+ * @parsed: true if @simple is the parsed command rather than a copy.
+ *
+ * The words of a parsed command are interned and carry their hash.
+ *
+ * Return: The CMD_FUNCTION definition, or NULL if none is defined.
+ */
+static Command *executor_find_function(ShellState *shell,
+				       SimpleCommand *simple, bool parsed)
+{
+	if (!parsed)
+		return function_lookup(&shell->functions, simple->argv[0]);
+	return function_find(&shell->functions, simple->argv[0],
+			     intern_hash(simple->argv[0]));
+}
+
+/**
+ * executor_call_function - Runs a shell function in the shell process.
+ * @shell: Pointer to the shell state.
+ * @simple: Pointer to the expanded SimpleCommand calling the function.
+ * @function: The CMD_FUNCTION definition.
+ *
+ * The positional parameters point into the caller's argument vector for
+ * the duration of the call; nothing is copied. The definition is held so
+ * the function may safely redefine itself.
+ *
+ * Return: The exit status of the function.
+ */
+static int executor_call_function(ShellState *shell, SimpleCommand *simple,
+				  Command *function)
+{
+	char **positional = shell->positional;
+	int positional_count = shell->positional_count;
+	int loop_depth = shell->loop_depth;
+	int status;
+
+	function->as.function.refs++;
+	shell->positional = simple->argv + 1;
+	shell->positional_count = simple->argc - 1;
+	shell->loop_depth = 0;
+	shell->function_depth++;
+
+	status = execute_command(shell, function->as.function.body);
+	if (shell->return_requested) {
+		shell->return_requested = false;
+		status = shell->last_status;
+	}
+
+	shell->function_depth--;
+	shell->loop_depth = loop_depth;
+	shell->positional_count = positional_count;
+	shell->positional = positional;
+	command_free(function);
+	return status;
+}
+
+/**
+ * executor_exec_simple - Replaces the current process with a command.
+ * @shell: Pointer to the shell state.
+ * @simple: Pointer to the SimpleCommand structure.
+ * @parsed: true if @simple is the parsed command rather than a copy.
+ *
+ * Must only be called in a child process, or in the shell itself when the
+ * command is the last one of the input; never returns.
+ */
+static __attribute__((noreturn)) void
+executor_exec_simple(ShellState *shell, SimpleCommand *simple, bool parsed)
+{
+	SimpleCommand expanded;
+	const Builtin *builtin;
+	Command *function;
+	char **envp;
+	char *path;
+
+	/* pipeline stages and jobs expand in the child; nothing to free */
+	if (simple->needs_expansion) {
+		if (!executor_expand_simple(shell, simple, &expanded))
+			executor_child_exit(2);
+		simple = &expanded;
+		parsed = false;
+	}
+
+	for (char **env = simple->envp; *env; env++) {
+		if (!var_assign(&shell->vars, *env, true))
+			executor_child_exit(2);
+	}
+
+	if (!executor_apply_redirections(shell, simple))
+		executor_child_exit(1);
+	if (simple->argc == 0)
+		executor_child_exit(0);
+
+	function = executor_find_function(shell, simple, parsed);
+	if (function)
+		executor_child_exit(
+			executor_call_function(shell, simple, function));
+
+	builtin = builtin_lookup(simple->argv[0]);
+	if (builtin) {
+		counter_add(COUNTER_BUILTINS, 1);
+		executor_child_exit(
+			builtin->func(shell, simple->argc, simple->argv));
+	}
+
+	path = executor_find_path(shell, simple->argv[0]);
+	counter_add(path ? COUNTER_PATH_FOUND : COUNTER_PATH_NOT_FOUND, 1);
+	if (!path) {
+		output_printf(STDERR_FILENO, "%s: %d: %s: not found\n",
+			      shell->name, shell->line_number, simple->argv[0]);
+		executor_child_exit(127);
+	}
+
+	envp = var_environ(&shell->vars);
+	if (!envp)
+		executor_child_exit(2);
+	execve(path, simple->argv, envp);
+	output_printf(STDERR_FILENO, "%s: %d: %s: %s\n", shell->name,
+		      shell->line_number, simple->argv[0], strerror(errno));
+	executor_child_exit(errno == ENOENT ? 127 : 126);
+}
+
+/**
+ * executor_redirect_shell - Applies redirections in the shell process.
+ * @shell: Pointer to the shell state.
+ * @simple: Pointer to the expanded SimpleCommand holding the redirections.
+ * @saved: Receives what executor_restore_shell needs to undo them.
+ *
+ * Each descriptor is copied above REDIRECT_MAX_FD with F_DUPFD_CLOEXEC
+ * before it is first replaced; nothing is saved for a command without
+ * redirections.
+ *
+ * Return: true on success, false if a redirection failed.
+ */
+static bool executor_redirect_shell(ShellState *shell, SimpleCommand *simple,
+				    ExecutorSaved *saved)
+{
+	saved->active = simple->redirect_count > 0;
+	if (!saved->active)
+		return true;
+	output_flush_all();
+	for (int fd = 0; fd <= REDIRECT_MAX_FD; fd++)
+		saved->fds[fd] = EXECUTOR_UNSAVED;
+
+	for (int i = 0; i < simple->redirect_count; i++) {
+		Redirect *redirect = &simple->redirects[i];
+		int *copy = &saved->fds[redirect->fd];
+
+		/* -1 records a descriptor that was closed */
+		if (*copy == EXECUTOR_UNSAVED) {
+			*copy = fcntl(redirect->fd, F_DUPFD_CLOEXEC,
+				      REDIRECT_MAX_FD + 1);
+			if (*copy < 0 && errno != EBADF) {
+				*copy = EXECUTOR_UNSAVED;
+				output_printf(STDERR_FILENO, "%s: %d: %s\n",
+					      shell->name, shell->line_number,
+					      strerror(errno));
+				return false;
+			}
+		}
+		if (!executor_apply_redirect(shell, redirect))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * executor_restore_shell - Undoes executor_redirect_shell.
+ * @saved: The state filled in by executor_redirect_shell.
+ */
+static void executor_restore_shell(ExecutorSaved *saved)
+{
+	if (!saved->active)
+		return;
+	output_flush_all();
+	for (int fd = 0; fd <= REDIRECT_MAX_FD; fd++) {
+		int copy = saved->fds[fd];
+
+		if (copy == EXECUTOR_UNSAVED)
+			continue;
+		if (copy < 0) {
+			close(fd);
+		} else {
+			dup2(copy, fd);
+			close(copy);
+		}
+	}
+}
+
+/**
+ * executor_run_in_shell - Runs a function or builtin in the shell process.
+ * @shell: Pointer to the shell state.
+ * @simple: Pointer to the SimpleCommand structure.
+ * @function: The CMD_FUNCTION definition to call, or NULL.
+ * @builtin: Pointer to the Builtin to run when @function is NULL.
+ *
+ * Assignments in front of a function or regular builtin, as in "FOO=1 f"
+ * or "IFS=: read a b", are exported for the call and undone afterwards;
+ * those in front of a special builtin such as ":" or "export" stay set.
+ * Output of consecutive builtins is coalesced in the output buffers; they
+ * are only flushed here when the standard descriptors must be redirected.
+ *
+ * Return: The exit status of the function or builtin.
+ */
+static int executor_run_in_shell(ShellState *shell, SimpleCommand *simple,
+				 Command *function, const Builtin *builtin)
+{
+	ExecutorSaved saved;
+	VarSaved *assigned = NULL;
+	int status = 1;
+
+	for (char **env = simple->envp; *env; env++) {
+		bool ok = function || !builtin->special ?
+				  var_assign_temporary(&shell->vars, *env,
+						       &assigned) :
+				  var_assign(&shell->vars, *env, false);
+
+		if (!ok) {
+			var_restore(&shell->vars, assigned);
+			shell->fatal_error = true;
+			return 2;
+		}
+	}
+
+	if (executor_redirect_shell(shell, simple, &saved)) {
+		if (function) {
+			status = executor_call_function(shell, simple,
+							function);
+		} else {
+			counter_add(COUNTER_BUILTINS, 1);
+			status = builtin->func(shell, simple->argc,
+					       simple->argv);
+		}
+		/* output to a closed or broken descriptor is an error */
+		if (saved.active && !output_flush_all()) {
+			output_printf(STDERR_FILENO, "%s: %d: %s: I/O error\n",
+				      shell->name, shell->line_number,
+				      simple->argv[0]);
+			status = 1;
+		}
+	}
+	executor_restore_shell(&saved);
+	var_restore(&shell->vars, assigned);
+	return status;
+}
+
+/**
+ * executor_run_expanded - Runs a simple command whose words are expanded.
+ * @shell: Pointer to the shell state.
+ * @simple: Pointer to the SimpleCommand structure.
+ * @parsed: true if @simple is the parsed command rather than a copy.
+ * Return: The exit status of the command.
+ */
+static int executor_run_expanded(ShellState *shell, SimpleCommand *simple,
+				 bool parsed)
+{
+	ExecutorSaved saved;
+	bool ok;
+	pid_t pid;
+
+	if (simple->argc == 0) {
+		for (char **env = simple->envp; *env; env++) {
+			if (!var_assign(&shell->vars, *env, false)) {
+				shell->fatal_error = true;
+				return 2;
+			}
+		}
+		/* files are still created and checked, then put back */
+		ok = executor_redirect_shell(shell, simple, &saved);
+		executor_restore_shell(&saved);
+		return ok ? 0 : 1;
+	}
+
+	/* functions shadow builtins, which shadow PATH */
+	Command *function = executor_find_function(shell, simple, parsed);
+	if (function)
+		return executor_run_in_shell(shell, simple, function, NULL);
+
+	const Builtin *builtin = builtin_lookup(simple->argv[0]);
+	if (builtin)
+		return executor_run_in_shell(shell, simple, NULL, builtin);
+
+	/* last command of the input with no jobs to report: skip the fork */
+	if (shell->tail_exec && !job_pending(shell)) {
+		output_flush_all();
+		fflush(NULL);
+		executor_exec_simple(shell, simple, parsed);
+	}
+
+	pid = executor_fork();
+	if (pid < 0) {
+		output_printf(STDERR_FILENO, "%s: %d: fork: %s\n",
+			      shell->name, shell->line_number, strerror(errno));
+		return 2;
+	}
+	if (pid == 0)
+		executor_exec_simple(shell, simple, parsed);
+	return executor_wait(shell, pid);
+}
+
+/**
+ * executor_run_simple - Expands and runs a simple command.
+ * @shell: Pointer to the shell state.
+ * @simple: Pointer to the SimpleCommand structure.
+ * Return: The exit status of the command.
+ */
+static int executor_run_simple(ShellState *shell, SimpleCommand *simple)
+{
+	SimpleCommand expanded;
+	int status;
+
+	if (!simple->needs_expansion)
+		return executor_run_expanded(shell, simple, true);
+
+	if (!executor_expand_simple(shell, simple, &expanded))
+		return 2;
+	status = executor_run_expanded(shell, &expanded, false);
+	executor_free_expanded(&expanded);
+	return status;
+}
+
+/**
+ * executor_run_in_child - Runs a command in an already forked child.
+ * @shell: Pointer to the shell state.
+ * @command: Pointer to the Command structure.
+ *
+ * Never returns.
+ */
+static void executor_run_in_child(ShellState *shell, Command *command)
+{
+	if (command->type == CMD_SIMPLE)
+		executor_exec_simple(shell, &command->as.command, true);
+
+	/* the child is the subshell, and its last command may replace it */
+	if (command->type == CMD_SUBSHELL && !command->redirect)
+		command = command->as.group.body;
+	shell->tail_exec = true;
+	executor_child_exit(executor_run(shell, command));
+}
+
+/**
+ * execute_spawn - Starts a command in a child process without waiting.
+ * @shell: Pointer to the shell state.
+ * @command: Pointer to the Command structure.
+ * @output: Descriptor to become the standard output of the child, or -1.
+ *
+ * The child is a subshell whose last command replaces it, so a simple
+ * command costs one fork and one exec.
+ *
+ * Return: Process ID of the child, or -1 after reporting a fork failure.
+ */
+pid_t execute_spawn(ShellState *shell, Command *command, int output)
+{
+	pid_t pid = executor_fork();
+
+	if (pid < 0) {
+		output_printf(STDERR_FILENO, "%s: %d: fork: %s\n",
+			      shell->name, shell->line_number, strerror(errno));
+		return -1;
+	}
+	if (pid == 0) {
+		if (output >= 0 && output != STDOUT_FILENO) {
+			if (dup2(output, STDOUT_FILENO) < 0)
+				executor_child_exit(2);
+			close(output);
+		}
+		executor_run_in_child(shell, command);
+	}
+	return pid;
+}
+
+/**
+ * executor_run_pipeline - Runs a pipeline of commands.
+ * @shell: Pointer to the shell state.
+ * @command: Pointer to the CMD_PIPE Command structure.
+ * Return: The exit status of the last command in the pipeline.
+ */
+static int executor_run_pipeline(ShellState *shell, Command *command)
+{
+	size_t count = 1, index;
+	Command **stages;
+	pid_t *pids;
+	int in_fd = -1, status = 0;
+
+	for (Command *c = command; c->type == CMD_PIPE; c = c->as.binary.left)
+		count++;
+
+	stages = malloc(sizeof(Command *) * count);
+	pids = malloc(sizeof(pid_t) * count);
+	if (!stages || !pids) {
+		free(stages);
+		free(pids);
+		shell->fatal_error = true;
+		return 2;
+	}
+
+	index = count;
+	for (Command *c = command; c->type == CMD_PIPE; c = c->as.binary.left) {
+		stages[--index] = c->as.binary.right;
+		if (c->as.binary.left->type != CMD_PIPE)
+			stages[--index] = c->as.binary.left;
+	}
+
+	for (index = 0; index < count; index++) {
+		int fds[2] = { -1, -1 };
+
+		if (index + 1 < count && pipe(fds) < 0) {
+			output_printf(STDERR_FILENO, "%s: %d: pipe: %s\n",
+				      shell->name, shell->line_number,
+				      strerror(errno));
+			break;
+		}
+
+		pids[index] = executor_fork();
+		if (pids[index] == 0) {
+			if (in_fd >= 0) {
+				dup2(in_fd, STDIN_FILENO);
+				close(in_fd);
+			}
+			if (fds[1] >= 0) {
+				dup2(fds[1], STDOUT_FILENO);
+				close(fds[1]);
+				close(fds[0]);
+			}
+			executor_run_in_child(shell, stages[index]);
+		}
+
+		if (in_fd >= 0)
+			close(in_fd);
+		if (fds[1] >= 0)
+			close(fds[1]);
+		in_fd = fds[0];
+
+		if (pids[index] < 0) {
+			output_printf(STDERR_FILENO, "%s: %d: fork: %s\n",
+				      shell->name, shell->line_number,
+				      strerror(errno));
+			break;
+		}
+	}
+	if (in_fd >= 0)
+		close(in_fd);
+
+	for (size_t i = 0; i < index; i++)
+		status = executor_wait(shell, pids[i]);
+	if (index < count)
+		status = 2;
+
+	free(stages);
+	free(pids);
+	return status;
+}
+
+/**
+ * executor_run_background - Starts a command as a background job.
+ * @shell: Pointer to the shell state.
+ * @command: Pointer to the Command structure.
+ *
+ * A jobserver slot is taken before forking and released once the job is
+ * reaped, which caps the number of concurrent background jobs.
+ *
+ * Return: 0 if the job was started, non-zero otherwise.
+ */
+static int executor_run_background(ShellState *shell, Command *command)
+{
+	bool has_token;
+	char token = 0;
+	pid_t pid;
+
+	if (!job_acquire_slot(shell, &has_token, &token)) {
+		output_printf(STDERR_FILENO, "%s: %d: jobserver: %s\n",
+			      shell->name, shell->line_number, strerror(errno));
+		return 1;
+	}
+
+	pid = executor_fork();
+	if (pid < 0) {
+		output_printf(STDERR_FILENO, "%s: %d: fork: %s\n",
+			      shell->name, shell->line_number, strerror(errno));
+		job_release_slot(shell, has_token, token);
+		return 2;
+	}
+	if (pid == 0)
+		executor_run_in_child(shell, command);
+
+	Job *job = job_add(shell, pid, has_token, token);
+	if (!job) {
+		shell->fatal_error = true;
+		return 2;
+	}
+	shell->last_job_pid = pid;
+	if (shell->is_interactive_mode)
+		output_printf(STDERR_FILENO, "[%d] %d\n", job->id, (int)pid);
+	return 0;
+}
+
+/**
+ * executor_run_not_tail - Runs a command that is followed by another one.
+ * @shell: Pointer to the shell state.
+ * @command: Pointer to the Command structure.
+ * Return: The exit status of the command.
+ */
+static int executor_run_not_tail(ShellState *shell, Command *command)
+{
+	bool tail_exec = shell->tail_exec;
+	int status;
+
+	shell->tail_exec = false;
+	status = execute_command(shell, command);
+	shell->tail_exec = tail_exec;
+	return status;
+}
+
+/**
+ * executor_print_seconds - Writes a duration in a TIMEFORMAT style.
+ * @tv: The duration.
+ * @precision: Number of fractional digits, 0 to 3.
+ * @long_format: Use the MMmSS.FFFs form.
+ */
+static void executor_print_seconds(const struct timeval *tv, int precision,
+				   bool long_format)
+{
+	static const long scale[] = { 1000000, 100000, 10000, 1000 };
+	long minutes = long_format ? tv->tv_sec / 60 : 0;
+	long seconds = tv->tv_sec - minutes * 60;
+	long fraction = tv->tv_usec / scale[precision];
+
+	if (long_format)
+		output_printf(STDERR_FILENO, "%ldm", minutes);
+	if (precision > 0)
+		output_printf(STDERR_FILENO, "%ld.%0*ld", seconds, precision,
+			      fraction);
+	else
+		output_printf(STDERR_FILENO, "%ld", seconds);
+	if (long_format)
+		output_putc(STDERR_FILENO, 's');
+}
+
+/**
+ * executor_report_time - Writes the report of a "time" command.
+ * @format: A TIMEFORMAT string.
+ * @real: Elapsed wall clock time.
+ * @usage: Accumulated user time, system time and peak RSS.
+ *
+ * Understands the bash escapes %[p][l]R, %[p][l]U, %[p][l]S and %P, plus
+ * %M for the peak RSS in kilobytes summed over every process measured.
+ */
+static void executor_report_time(const char *format,
+				 const struct timeval *real,
+				 const struct rusage *usage)
+{
+	for (const char *f = format; *f; f++) {
+		int precision = 3;
+		bool long_format = false;
+
+		if (*f != '%') {
+			size_t span = strcspn(f, "%");
+			output_write(STDERR_FILENO, f, span);
+			f += span - 1;
+			continue;
+		}
+		f++;
+		if (*f >= '0' && *f <= '9') {
+			precision = *f - '0' > 3 ? 3 : *f - '0';
+			f++;
+		}
+		if (*f == 'l') {
+			long_format = true;
+			f++;
+		}
+
+		switch (*f) {
+		case 'R':
+			executor_print_seconds(real, precision, long_format);
+			break;
+		case 'U':
+			executor_print_seconds(&usage->ru_utime, precision,
+					       long_format);
+			break;
+		case 'S':
+			executor_print_seconds(&usage->ru_stime, precision,
+					       long_format);
+			break;
+		case 'P': {
+			double elapsed = real->tv_sec + real->tv_usec / 1e6;
+			double cpu = usage->ru_utime.tv_sec +
+				     usage->ru_stime.tv_sec +
+				     (usage->ru_utime.tv_usec +
+				      usage->ru_stime.tv_usec) /
+					     1e6;
+			output_printf(STDERR_FILENO, "%.2f",
+				      elapsed > 0 ? cpu * 100 / elapsed : 0);
+			break;
+		}
+		case 'M':
+			output_printf(STDERR_FILENO, "%ld", usage->ru_maxrss);
+			break;
+		case '%':
+			output_putc(STDERR_FILENO, '%');
+			break;
+		case '\0':
+			return;
+		default:
+			output_putc(STDERR_FILENO, '%');
+			output_putc(STDERR_FILENO, *f);
+			break;
+		}
+	}
+}
+
+/**
+ * executor_run_time - Runs a pipeline and reports the time it took.
+ * @shell: Pointer to the shell state.
+ * @command: Pointer to the CMD_TIME Command structure.
+ *
+ * Wall time comes from CLOCK_MONOTONIC; user and system time of every
+ * stage come from wait4, plus the shell's own time spent in builtins.
+ * The report uses TIMEFORMAT when set, or the POSIX format for "time -p".
+ *
+ * Return: The exit status of the pipeline.
+ */
+static int executor_run_time(ShellState *shell, Command *command)
+{
+	struct rusage *outer = shell->child_usage;
+	struct rusage total, self_start, self_end;
+	struct timespec start, end;
+	struct timeval real, self;
+	const char *format;
+	int status;
+
+	memset(&total, 0, sizeof(total));
+	getrusage(RUSAGE_SELF, &self_start);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	shell->child_usage = &total;
+	status = executor_run_not_tail(shell, command->as.timed.body);
+	shell->child_usage = outer;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	getrusage(RUSAGE_SELF, &self_end);
+
+	if (outer) {
+		timeradd(&outer->ru_utime, &total.ru_utime, &outer->ru_utime);
+		timeradd(&outer->ru_stime, &total.ru_stime, &outer->ru_stime);
+		outer->ru_maxrss += total.ru_maxrss;
+	}
+
+	timersub(&self_end.ru_utime, &self_start.ru_utime, &self);
+	timeradd(&total.ru_utime, &self, &total.ru_utime);
+	timersub(&self_end.ru_stime, &self_start.ru_stime, &self);
+	timeradd(&total.ru_stime, &self, &total.ru_stime);
+
+	real.tv_sec = end.tv_sec - start.tv_sec;
+	real.tv_usec = (end.tv_nsec - start.tv_nsec) / 1000;
+	if (real.tv_usec < 0) {
+		real.tv_sec--;
+		real.tv_usec += 1000000;
+	}
+
+	if (command->as.timed.posix_format)
+		format = "real %2R\nuser %2U\nsys %2S";
+	else
+		format = var_get(&shell->vars, "TIMEFORMAT");
+	if (!format)
+		format = "\nreal\t%3lR\nuser\t%3lU\nsys\t%3lS\nrss\t%MK";
+
+	executor_report_time(format, &real, &total);
+	output_putc(STDERR_FILENO, '\n');
+	return status;
+}
+
+/**
+ * executor_interrupted - Checks if the rest of a command list must be skipped.
+ * @shell: Pointer to the shell state.
+ * Return: true after an error, exit, return, break or continue.
+ */
+static bool executor_interrupted(ShellState *shell)
+{
+	return shell->fatal_error || shell->had_error ||
+	       shell->exit_requested || shell->return_requested ||
+	       shell->break_count > 0 || shell->continue_count > 0;
+}
+
+/**
+ * executor_loop_done - Decides if a loop stops after running its body.
+ * @shell: Pointer to the shell state.
+ *
+ * A pending "break N" or "continue N" is consumed one loop level at a time;
+ * "continue" only resumes the loop it finally reaches.
+ *
+ * Return: true if the loop must stop, false if it goes on.
+ */
+static bool executor_loop_done(ShellState *shell)
+{
+	if (shell->break_count > 0) {
+		shell->break_count--;
+		return true;
+	}
+	if (shell->continue_count > 0)
+		return --shell->continue_count > 0;
+	return shell->fatal_error || shell->had_error ||
+	       shell->exit_requested || shell->return_requested;
+}
+
+/**
+ * executor_run_if - Runs an if clause.
+ * @shell: Pointer to the shell state.
+ * @command: Pointer to the CMD_IF Command structure.
+ * Return: The exit status of the branch run, or 0 if none was.
+ */
+static int executor_run_if(ShellState *shell, Command *command)
+{
+	int status;
+
+	status = executor_run_not_tail(shell, command->as.if_clause.condition);
+	if (executor_interrupted(shell))
+		return status;
+	if (status == 0)
+		return execute_command(shell, command->as.if_clause.then_part);
+	if (command->as.if_clause.else_part)
+		return execute_command(shell, command->as.if_clause.else_part);
+	return 0;
+}
+
+/**
+ * executor_run_loop - Runs a while or until loop.
+ * @shell: Pointer to the shell state.
+ * @command: Pointer to the CMD_WHILE or CMD_UNTIL Command structure.
+ * Return: The exit status of the last body run, or 0 if none was.
+ */
+static int executor_run_loop(ShellState *shell, Command *command)
+{
+	bool until = command->type == CMD_UNTIL;
+	int status = 0;
+
+	shell->loop_depth++;
+	for (;;) {
+		int test = executor_run_not_tail(shell,
+						 command->as.loop.condition);
+		if (executor_interrupted(shell)) {
+			if (executor_loop_done(shell))
+				break;
+			continue;
+		}
+		if ((test == 0) == until)
+			break;
+
+		status = executor_run_not_tail(shell, command->as.loop.body);
+		if (executor_loop_done(shell))
+			break;
+	}
+	shell->loop_depth--;
+	return status;
+}
+
+/**
+ * executor_run_for - Runs a for loop.
+ * @shell: Pointer to the shell state.
+ * @command: Pointer to the CMD_FOR Command structure.
+ *
+ * The word list is expanded once before the first iteration; without
+ * "in", the loop iterates over the positional parameters in place.
+ *
+ * Return: The exit status of the last body run, or 0 if none was.
+ */
+static int executor_run_for(ShellState *shell, Command *command)
+{
+	WordList words = { NULL, 0, 0 };
+	char **items = shell->positional;
+	int count = shell->positional_count;
+	int status = 0;
+
+	if (command->as.for_clause.has_in) {
+		char **word = command->as.for_clause.words;
+		for (; word && *word; word++) {
+			if (!expand_fields(shell, *word, &words,
+					   &command->as.for_clause.arith)) {
+				word_list_free(&words);
+				if (!shell->had_error)
+					shell->fatal_error = true;
+				return 2;
+			}
+		}
+		items = words.items;
+		count = words.count;
+	}
+
+	shell->loop_depth++;
+	for (int i = 0; i < count; i++) {
+		if (!var_set(&shell->vars, command->as.for_clause.name,
+			     items[i], false)) {
+			shell->fatal_error = true;
+			status = 2;
+			break;
+		}
+		status = executor_run_not_tail(shell,
+					       command->as.for_clause.body);
+		if (executor_loop_done(shell))
+			break;
+	}
+	shell->loop_depth--;
+	word_list_free(&words);
+	return status;
+}
+
+/**
+ * executor_run_case - Runs a case command.
+ * @shell: Pointer to the shell state.
+ * @command: Pointer to the CMD_CASE Command structure.
+ * Return: The exit status of the arm run, or 0 if none was.
+ */
+static int executor_run_case(ShellState *shell, Command *command)
+{
+	char *word = expand_word(shell, command->as.case_clause.word,
+				 &command->as.case_clause.arith);
+	int arm;
+
+	if (!word) {
+		if (!shell->had_error)
+			shell->fatal_error = true;
+		return 2;
+	}
+	arm = pattern_set_match(shell, command->as.case_clause.patterns, word,
+				&command->as.case_clause.arith);
+	free(word);
+	if (shell->had_error || shell->fatal_error)
+		return 2;
+	if (arm < 0 || !command->as.case_clause.arms[arm].body)
+		return 0;
+	return execute_command(shell, command->as.case_clause.arms[arm].body);
+}
+
+/**
+ * executor_word_reads_status - Checks if a word expands $?.
+ * @word: The word as parsed, may be NULL.
+ * Return: true if the word depends on the command run just before.
+ */
+static bool executor_word_reads_status(const char *word)
+{
+	static const char markers[] = { EXPAND_VAR, EXPAND_QUOTED_VAR, '\0' };
+
+	if (!word)
+		return false;
+	while ((word = strpbrk(word, markers)) != NULL) {
+		word++;
+		if (*word == '{')
+			word++;
+		if (*word == '?')
+			return true;
+	}
+	return false;
+}
+
+/**
+ * executor_word_is_stateless - Checks if a word expands the same anywhere.
+ * @word: The word as parsed, may be NULL.
+ * Return: true unless the word holds an arithmetic expansion, which may
+ *         assign variables, or reads $?.
+ */
+static bool executor_word_is_stateless(const char *word)
+{
+	if (!word)
+		return true;
+	return !strchr(word, EXPAND_ARITH) && !executor_word_reads_status(word);
+}
+
+/**
+ * executor_words_read_status - Checks a NULL-terminated array of words.
+ * @words: The array, may be NULL.
+ * Return: true if any of the words expands $?.
+ */
+static bool executor_words_read_status(char **words)
+{
+	for (; words && *words; words++) {
+		if (executor_word_reads_status(*words))
+			return true;
+	}
+	return false;
+}
+
+/**
+ * executor_simple_reads_status - Checks the words of a simple command.
+ * @simple: Pointer to the SimpleCommand structure, may be NULL.
+ * Return: true if an argument, assignment or redirection expands $?.
+ */
+static bool executor_simple_reads_status(SimpleCommand *simple)
+{
+	if (!simple)
+		return false;
+	if (executor_words_read_status(simple->argv) ||
+	    executor_words_read_status(simple->envp))
+		return true;
+	for (int i = 0; i < simple->redirect_count; i++) {
+		if (executor_word_reads_status(simple->redirects[i].word))
+			return true;
+	}
+	return false;
+}
+
+/**
+ * executor_reads_status - Checks if a command anywhere expands $?.
+ * @command: Pointer to the Command structure, may be NULL.
+ *
+ * Pipeline stages and subshells cannot change the shell, but they still
+ * see the $? left by the command before them.
+ *
+ * Return: true if running the command depends on the previous status.
+ */
+static bool executor_reads_status(Command *command)
+{
+	if (!command)
+		return false;
+	if (executor_simple_reads_status(command->redirect))
+		return true;
+
+	switch (command->type) {
+	case CMD_SIMPLE:
+		return executor_simple_reads_status(&command->as.command);
+	case CMD_PIPE:
+	case CMD_AND:
+	case CMD_OR:
+	case CMD_SEPARATOR:
+		return executor_reads_status(command->as.binary.left) ||
+		       executor_reads_status(command->as.binary.right);
+	case CMD_TIME:
+		return executor_reads_status(command->as.timed.body);
+	case CMD_IF:
+		return executor_reads_status(command->as.if_clause.condition) ||
+		       executor_reads_status(command->as.if_clause.then_part) ||
+		       executor_reads_status(command->as.if_clause.else_part);
+	case CMD_WHILE:
+	case CMD_UNTIL:
+		return executor_reads_status(command->as.loop.condition) ||
+		       executor_reads_status(command->as.loop.body);
+	case CMD_FOR:
+		return executor_words_read_status(
+			       command->as.for_clause.words) ||
+		       executor_reads_status(command->as.for_clause.body);
+	case CMD_CASE:
+		if (executor_word_reads_status(command->as.case_clause.word))
+			return true;
+		for (int i = 0; i < command->as.case_clause.arm_count; i++) {
+			CaseArm *arm = &command->as.case_clause.arms[i];
+
+			if (executor_words_read_status(arm->patterns) ||
+			    executor_reads_status(arm->body))
+				return true;
+		}
+		return false;
+	case CMD_GROUP:
+	case CMD_SUBSHELL:
+		return executor_reads_status(command->as.group.body);
+	case CMD_FUNCTION:
+		return false;
+	}
+	return false;
+}
+
+/**
+ * executor_words_are_stateless - Checks a NULL-terminated array of words.
+ * @words: The array, may be NULL.
+ * Return: true if expanding every word changes nothing.
+ */
+static bool executor_words_are_stateless(char **words)
 {
-	(void)command;
-	// Execution logic to be implemented
+	for (; words && *words; words++) {
+		if (!executor_word_is_stateless(*words))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * executor_simple_is_stateless - Checks if a simple command changes nothing.
+ * @shell: Pointer to the shell state.
+ * @simple: Pointer to the SimpleCommand structure as parsed.
+ * Return: true for external commands and stateless builtins whose words
+ *         expand without side effects, false otherwise.
+ */
+static bool executor_simple_is_stateless(ShellState *shell,
+					 SimpleCommand *simple)
+{
+	const Builtin *builtin;
+
+	if (!executor_words_are_stateless(simple->argv) ||
+	    !executor_words_are_stateless(simple->envp))
+		return false;
+	for (int i = 0; i < simple->redirect_count; i++) {
+		if (!executor_word_is_stateless(simple->redirects[i].word))
+			return false;
+	}
+	/* assignments without a command set shell variables */
+	if (simple->argc == 0)
+		return !simple->envp || !*simple->envp;
+	if (expand_needed(simple->argv[0]) ||
+	    function_lookup(&shell->functions, simple->argv[0]))
+		return false;
+	builtin = builtin_lookup(simple->argv[0]);
+	if (builtin && builtin->special && simple->envp && *simple->envp)
+		return false;
+	return !builtin || builtin->stateless;
+}
+
+/**
+ * execute_is_stateless - Checks if running a command leaves the shell as is.
+ * @shell: Pointer to the shell state.
+ * @command: Pointer to the Command structure, may be NULL.
+ *
+ * Commands that only start processes, such as external commands and
+ * pipelines, qualify; anything that may assign a variable, change the
+ * directory, define a function, start a job or exit does not. Nor does
+ * anything that reads $?, so that it may also run before the command
+ * preceding it has finished.
+ *
+ * Return: true if the command may run in the shell instead of a subshell.
+ */
+bool execute_is_stateless(ShellState *shell, Command *command)
+{
+	if (!command)
+		return true;
+	if (command->is_background ||
+	    (command->redirect &&
+	     !executor_simple_is_stateless(shell, command->redirect)))
+		return false;
+
+	switch (command->type) {
+	case CMD_SIMPLE:
+		return executor_simple_is_stateless(shell,
+						    &command->as.command);
+	case CMD_PIPE:
+	case CMD_SUBSHELL:
+		/* their commands run in children, but may still read $? */
+		return !executor_reads_status(command);
+	case CMD_AND:
+	case CMD_OR:
+	case CMD_SEPARATOR:
+		return execute_is_stateless(shell, command->as.binary.left) &&
+		       execute_is_stateless(shell, command->as.binary.right);
+	case CMD_TIME:
+		return execute_is_stateless(shell, command->as.timed.body);
+	case CMD_IF:
+		return execute_is_stateless(shell,
+					    command->as.if_clause.condition) &&
+		       execute_is_stateless(shell,
+					    command->as.if_clause.then_part) &&
+		       execute_is_stateless(shell,
+					    command->as.if_clause.else_part);
+	case CMD_WHILE:
+	case CMD_UNTIL:
+		return execute_is_stateless(shell,
+					    command->as.loop.condition) &&
+		       execute_is_stateless(shell, command->as.loop.body);
+	case CMD_CASE:
+		if (!executor_word_is_stateless(command->as.case_clause.word))
+			return false;
+		for (int i = 0; i < command->as.case_clause.arm_count; i++) {
+			CaseArm *arm = &command->as.case_clause.arms[i];
+
+			if (!executor_words_are_stateless(arm->patterns) ||
+			    !execute_is_stateless(shell, arm->body))
+				return false;
+		}
+		return true;
+	case CMD_GROUP:
+		return execute_is_stateless(shell, command->as.group.body);
+	case CMD_FOR:
+	case CMD_FUNCTION:
+		return false;
+	}
+	return false;
+}
+
+/**
+ * executor_run_subshell - Runs a "( list )" subshell.
+ * @shell: Pointer to the shell state.
+ * @command: Pointer to the CMD_SUBSHELL Command structure.
+ *
+ * A body that cannot change the shell runs in the shell itself, so that
+ * "( cmd )" costs the same single fork as "cmd". Otherwise the body runs
+ * in a forked copy of the shell, whose last command may replace it.
+ *
+ * Return: The exit status of the body.
+ */
+static int executor_run_subshell(ShellState *shell, Command *command)
+{
+	Command *body = command->as.group.body;
+	pid_t pid;
+	int status;
+
+	if (execute_is_stateless(shell, body))
+		return execute_command(shell, body);
+
+	pid = executor_fork();
+	if (pid < 0) {
+		output_printf(STDERR_FILENO, "%s: %d: fork: %s\n",
+			      shell->name, shell->line_number, strerror(errno));
+		return 2;
+	}
+	if (pid == 0) {
+		shell->tail_exec = true;
+		status = execute_command(shell, body);
+		executor_child_exit(shell->fatal_error ? 2 : status);
+	}
+	return executor_wait(shell, pid);
+}
+
+/**
+ * executor_run_command - Runs a command in the foreground.
+ * @shell: Pointer to the shell state.
+ * @command: Pointer to the Command structure, with its redirections
+ *           already applied.
+ * Return: The exit status of the command.
+ */
+static int executor_run_command(ShellState *shell, Command *command)
+{
+	int status;
+
+	switch (command->type) {
+	case CMD_SIMPLE:
+		return executor_run_simple(shell, &command->as.command);
+	case CMD_PIPE:
+		return executor_run_pipeline(shell, command);
+	case CMD_AND:
+		status = executor_run_not_tail(shell, command->as.binary.left);
+		if (status == 0 && !executor_interrupted(shell))
+			status = execute_command(shell,
+						 command->as.binary.right);
+		return status;
+	case CMD_OR:
+		status = executor_run_not_tail(shell, command->as.binary.left);
+		if (status != 0 && !executor_interrupted(shell))
+			status = execute_command(shell,
+						 command->as.binary.right);
+		return status;
+	case CMD_SEPARATOR:
+		status = executor_run_not_tail(shell, command->as.binary.left);
+		if (executor_interrupted(shell))
+			return shell->fatal_error ? 2 : status;
+		return execute_command(shell, command->as.binary.right);
+	case CMD_TIME:
+		return executor_run_time(shell, command);
+	case CMD_IF:
+		return executor_run_if(shell, command);
+	case CMD_WHILE:
+	case CMD_UNTIL:
+		return executor_run_loop(shell, command);
+	case CMD_FOR:
+		return executor_run_for(shell, command);
+	case CMD_CASE:
+		return executor_run_case(shell, command);
+	case CMD_GROUP:
+		return execute_command(shell, command->as.group.body);
+	case CMD_SUBSHELL:
+		return executor_run_subshell(shell, command);
+	case CMD_FUNCTION:
+		if (!function_define(&shell->functions, command)) {
+			shell->fatal_error = true;
+			return 2;
+		}
+		return 0;
+	}
 	return 0;
 }
+
+/**
+ * executor_run_redirected - Runs a compound command with redirections.
+ * @shell: Pointer to the shell state.
+ * @command: Pointer to the Command structure, with redirections.
+ *
+ * The redirections are set up once around the whole command, in the shell
+ * itself, and undone afterwards.
+ *
+ * Return: The exit status of the command.
+ */
+static int executor_run_redirected(ShellState *shell, Command *command)
+{
+	SimpleCommand *redirect = command->redirect;
+	SimpleCommand expanded;
+	ExecutorSaved saved;
+	int status = 1;
+
+	if (redirect->needs_expansion) {
+		if (!executor_expand_simple(shell, redirect, &expanded))
+			return 2;
+		redirect = &expanded;
+	}
+	if (executor_redirect_shell(shell, redirect, &saved))
+		status = executor_run_command(shell, command);
+	executor_restore_shell(&saved);
+	if (redirect == &expanded)
+		executor_free_expanded(&expanded);
+	return status;
+}
+
+/**
+ * executor_run - Runs a command in the foreground.
+ * @shell: Pointer to the shell state.
+ * @command: Pointer to the Command structure.
+ * Return: The exit status of the command.
+ */
+static int executor_run(ShellState *shell, Command *command)
+{
+	if (command->redirect)
+		return executor_run_redirected(shell, command);
+	return executor_run_command(shell, command);
+}
+
+/**
+ * execute_command - Executes a parsed command tree.
+ * @shell: Pointer to the shell state.
+ * @command: Pointer to the Command structure, may be NULL.
+ *
+ * A command marked as background runs as a job.
+ *
+ * Return: The exit status of the command.
+ */
+int execute_command(ShellState *shell, Command *command)
+{
+	int status;
+
+	if (!command)
+		return shell->last_status;
+
+	if (command->is_background)
+		status = executor_run_background(shell, command);
+	else
+		status = executor_run(shell, command);
+
+	shell->last_status = status;
+	return status;
+}
@@ -2,7 +2,11 @@
 #define EXECUTOR_H
 
 #include "command.h"
+#include "shell.h"
 
-int execute_command(Command *command);
+int execute_command(ShellState *shell, Command *command);
+pid_t execute_spawn(ShellState *shell, Command *command, int output);
+int execute_wait_status(int status);
+bool execute_is_stateless(ShellState *shell, Command *command);
 
 #endif
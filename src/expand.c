@@ -0,0 +1,475 @@
+#include "expand.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct Buffer {
+	char *data;
+	size_t length;
+	size_t capacity;
+} Buffer;
+
+/**
+ * buffer_append - Appends characters to a buffer.
+ * @buf: Pointer to the Buffer structure.
+ * @str: The characters to append.
+ * @length: Number of characters to append.
+ * Return: true on success, false on allocation failure.
+ */
+static bool buffer_append(Buffer *buf, const char *str, size_t length)
+{
+	if (buf->length + length + 1 > buf->capacity) {
+		size_t capacity = (buf->length + length + 1) * 2;
+		char *data = realloc(buf->data, capacity);
+		if (!data)
+			return false;
+		buf->data = data;
+		buf->capacity = capacity;
+	}
+	memcpy(buf->data + buf->length, str, length);
+	buf->length += length;
+	buf->data[buf->length] = '\0';
+	return true;
+}
+
+/**
+ * buffer_take - Returns the buffer contents and resets the buffer.
+ * @buf: Pointer to the Buffer structure.
+ * Return: The NUL-terminated string, or NULL on allocation failure.
+ */
+static char *buffer_take(Buffer *buf)
+{
+	char *data = buf->data ? buf->data : strdup("");
+
+	buf->data = NULL;
+	buf->length = 0;
+	buf->capacity = 0;
+	return data;
+}
+
+/**
+ * is_name_char - Checks if a character may appear in a variable name.
+ * @c: The character to check.
+ * @first: true if this is the first character of the name.
+ * Return: true if allowed, false otherwise.
+ */
+static bool is_name_char(char c, bool first)
+{
+	return c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+	       (!first && c >= '0' && c <= '9');
+}
+
+/**
+ * expand_positional - Returns a positional parameter.
+ * @shell: Pointer to the shell state.
+ * @name: The decimal parameter number.
+ * @length: Length of the number.
+ * Return: The value, or "" if the parameter is not set.
+ */
+static const char *expand_positional(ShellState *shell, const char *name,
+				     size_t length)
+{
+	int index = 0;
+
+	for (size_t i = 0; i < length; i++) {
+		if (name[i] < '0' || name[i] > '9' || index > 100000)
+			return "";
+		index = index * 10 + (name[i] - '0');
+	}
+	if (index == 0)
+		return shell->name;
+	if (index > shell->positional_count)
+		return "";
+	return shell->positional[index - 1];
+}
+
+/**
+ * expand_parameter - Parses and looks up the parameter after a marker.
+ * @shell: Pointer to the shell state.
+ * @word: Pointer to the character following the marker.
+ * @used: Set to the number of characters consumed.
+ * @scratch: Buffer for values that must be formatted, such as $? or $*.
+ *
+ * Return: The value, "" for unset parameters, or NULL if the marker does
+ *         not start a parameter and stands for a literal '$'.
+ */
+static const char *expand_parameter(ShellState *shell, const char *word,
+				    size_t *used, Buffer *scratch)
+{
+	const char *name = word;
+	size_t length = 0;
+	char lookup[256];
+	const char *value;
+
+	*used = 0;
+	if (*word == '{') {
+		const char *close = strchr(word, '}');
+		if (!close)
+			return NULL;
+		name = word + 1;
+		length = close - name;
+		*used = length + 2;
+	} else if (is_name_char(*word, true)) {
+		while (is_name_char(word[length], length == 0))
+			length++;
+		*used = length;
+	} else if (*word && strchr("?$!#@*0123456789", *word)) {
+		length = 1;
+		*used = 1;
+	} else {
+		return NULL;
+	}
+
+	if (length == 0)
+		return "";
+	if (name[0] >= '0' && name[0] <= '9')
+		return expand_positional(shell, name, length);
+
+	if (length == 1 && strchr("?$!#@*", *name)) {
+		char number[32];
+
+		scratch->length = 0;
+		if (scratch->data)
+			scratch->data[0] = '\0';
+		switch (*name) {
+		case '?':
+			snprintf(number, sizeof(number), "%d",
+				 shell->last_status);
+			break;
+		case '$':
+			snprintf(number, sizeof(number), "%d", (int)shell->pid);
+			break;
+		case '!':
+			number[0] = '\0';
+			if (shell->last_job_pid > 0)
+				snprintf(number, sizeof(number), "%d",
+					 (int)shell->last_job_pid);
+			break;
+		case '#':
+			snprintf(number, sizeof(number), "%d",
+				 shell->positional_count);
+			break;
+		default:
+			/* "$@" is split by expand_fields; here both join */
+			number[0] = '\0';
+			for (int i = 0; i < shell->positional_count; i++) {
+				const char *arg = shell->positional[i];
+				if (i > 0 && !buffer_append(scratch, " ", 1))
+					return "";
+				if (!buffer_append(scratch, arg, strlen(arg)))
+					return "";
+			}
+			break;
+		}
+		if (!buffer_append(scratch, number, strlen(number)))
+			return "";
+		return scratch->data ? scratch->data : "";
+	}
+
+	if (length >= sizeof(lookup))
+		return "";
+	memcpy(lookup, name, length);
+	lookup[length] = '\0';
+	value = var_get(&shell->vars, lookup);
+	return value ? value : "";
+}
+
+/**
+ * expand_needed - Checks if a word contains parameter expansions.
+ * @word: The word as produced by the lexer.
+ * Return: true if the word must be expanded before use.
+ */
+bool expand_needed(const char *word)
+{
+	return strpbrk(word, "\001\002\003") != NULL;
+}
+
+/**
+ * expand_arith - Appends the value of an arithmetic expansion.
+ * @shell: Pointer to the shell state.
+ * @word: Pointer to the expression, following its opening marker.
+ * @buf: The buffer to append the value to.
+ * @cache: Compiled expressions of the command, or NULL.
+ *
+ * Return: Number of characters consumed, including the closing marker, or
+ *         0 on failure.
+ */
+static size_t expand_arith(ShellState *shell, const char *word, Buffer *buf,
+			   Arith **cache)
+{
+	const char *end = strchr(word, EXPAND_ARITH);
+	char number[32];
+	long long value;
+
+	if (!end || !arith_expand(shell, word, end - word, cache, &value))
+		return 0;
+	snprintf(number, sizeof(number), "%lld", value);
+	if (!buffer_append(buf, number, strlen(number)))
+		return 0;
+	return end - word + 1;
+}
+
+/**
+ * expand_append_escaped - Appends a string with its glob characters quoted.
+ * @buf: The buffer to append to.
+ * @str: The string to append.
+ * Return: true on success, false on allocation failure.
+ */
+static bool expand_append_escaped(Buffer *buf, const char *str)
+{
+	while (*str) {
+		size_t span = strcspn(str, "*?[\\");
+
+		if (!buffer_append(buf, str, span))
+			return false;
+		str += span;
+		if (!*str)
+			break;
+		if (!buffer_append(buf, "\\", 1) || !buffer_append(buf, str, 1))
+			return false;
+		str++;
+	}
+	return true;
+}
+
+/**
+ * expand_word_mode - Expands the parameters in a word.
+ * @shell: Pointer to the shell state.
+ * @word: The word as produced by the lexer.
+ * @cache: Compiled arithmetic of the command owning the word, or NULL.
+ * @pattern: Whether to backslash-quote the glob characters that come from
+ *           an expansion inside double quotes.
+ *
+ * Return: Newly allocated expanded string, or NULL on failure.
+ */
+static char *expand_word_mode(ShellState *shell, const char *word,
+			      Arith **cache, bool pattern)
+{
+	Buffer buf = { NULL, 0, 0 };
+	Buffer scratch = { NULL, 0, 0 };
+
+	while (*word) {
+		size_t span = strcspn(word, "\001\002\003");
+		size_t used;
+		const char *value;
+		char marker;
+		bool ok;
+
+		if (!buffer_append(&buf, word, span))
+			goto fail;
+		word += span;
+		if (!*word)
+			break;
+
+		marker = *word++;
+		if (marker == EXPAND_ARITH) {
+			used = expand_arith(shell, word, &buf, cache);
+			if (!used)
+				goto fail;
+			word += used;
+			continue;
+		}
+		value = expand_parameter(shell, word, &used, &scratch);
+		if (!value)
+			value = "$";
+		if (pattern && marker == EXPAND_QUOTED_VAR)
+			ok = expand_append_escaped(&buf, value);
+		else
+			ok = buffer_append(&buf, value, strlen(value));
+		if (!ok)
+			goto fail;
+		word += used;
+	}
+	free(scratch.data);
+	return buffer_take(&buf);
+
+fail:
+	free(scratch.data);
+	free(buf.data);
+	return NULL;
+}
+
+/**
+ * expand_word - Expands the parameters in a word without field splitting.
+ * @shell: Pointer to the shell state.
+ * @word: The word as produced by the lexer.
+ * @cache: Compiled arithmetic of the command owning the word, or NULL.
+ *
+ * Return: Newly allocated expanded string, or NULL on failure; an
+ *         arithmetic error also sets shell->had_error.
+ */
+char *expand_word(ShellState *shell, const char *word, Arith **cache)
+{
+	return expand_word_mode(shell, word, cache, false);
+}
+
+/**
+ * expand_pattern - Expands a word used as a pattern.
+ * @shell: Pointer to the shell state.
+ * @word: The word as produced by the lexer.
+ * @cache: Compiled arithmetic of the command owning the word, or NULL.
+ *
+ * Like expand_word, but "*", "?", "[" and backslashes that come from an
+ * expansion inside double quotes are escaped, so they only match themselves.
+ *
+ * Return: Newly allocated pattern, or NULL on failure; an arithmetic error
+ *         also sets shell->had_error.
+ */
+char *expand_pattern(ShellState *shell, const char *word, Arith **cache)
+{
+	return expand_word_mode(shell, word, cache, true);
+}
+
+/**
+ * expand_is_at - Checks if a marker introduces "$@".
+ * @word: Pointer to the character following the marker.
+ * Return: true for "$@" and "${@}".
+ */
+static bool expand_is_at(const char *word)
+{
+	return word[0] == '@' || strncmp(word, "{@}", 3) == 0;
+}
+
+/**
+ * expand_fields - Expands a word into fields.
+ * @shell: Pointer to the shell state.
+ * @word: The word as produced by the lexer.
+ * @list: The WordList the resulting fields are appended to.
+ * @cache: Compiled arithmetic of the command owning the word, or NULL.
+ *
+ * The results of unquoted expansions are split on blanks and newlines; an
+ * unquoted expansion that is empty produces no field at all. A quoted
+ * "$@" produces one field per positional parameter. Arithmetic results
+ * are numbers and are never split.
+ *
+ * Return: true on success, false on failure.
+ */
+bool expand_fields(ShellState *shell, const char *word, WordList *list,
+		   Arith **cache)
+{
+	Buffer buf = { NULL, 0, 0 };
+	Buffer scratch = { NULL, 0, 0 };
+	bool started = *word == '\0';
+
+	while (*word) {
+		size_t span = strcspn(word, "\001\002\003");
+		size_t used;
+		const char *value;
+		bool quoted;
+
+		if (span > 0) {
+			if (!buffer_append(&buf, word, span))
+				goto fail;
+			started = true;
+			word += span;
+		}
+		if (!*word)
+			break;
+
+		if (*word == EXPAND_ARITH) {
+			used = expand_arith(shell, word + 1, &buf, cache);
+			if (!used)
+				goto fail;
+			word += used + 1;
+			started = true;
+			continue;
+		}
+
+		quoted = *word++ == EXPAND_QUOTED_VAR;
+		if (quoted && expand_is_at(word)) {
+			for (int i = 0; i < shell->positional_count; i++) {
+				const char *arg = shell->positional[i];
+				if (i > 0 &&
+				    !word_list_append(list, buffer_take(&buf)))
+					goto fail;
+				if (!buffer_append(&buf, arg, strlen(arg)))
+					goto fail;
+				started = true;
+			}
+			word += word[0] == '@' ? 1 : 3;
+			continue;
+		}
+
+		value = expand_parameter(shell, word, &used, &scratch);
+		word += used;
+		if (!value) {
+			value = "$";
+			quoted = true;
+		}
+
+		if (quoted) {
+			if (!buffer_append(&buf, value, strlen(value)))
+				goto fail;
+			started = true;
+			continue;
+		}
+
+		while (*value) {
+			size_t part = strcspn(value, " \t\n");
+
+			if (part > 0) {
+				if (!buffer_append(&buf, value, part))
+					goto fail;
+				started = true;
+				value += part;
+			}
+			if (!*value)
+				break;
+			if (started &&
+			    !word_list_append(list, buffer_take(&buf)))
+				goto fail;
+			started = false;
+			value += strspn(value, " \t\n");
+		}
+	}
+
+	if (started && !word_list_append(list, buffer_take(&buf)))
+		goto fail;
+	free(scratch.data);
+	free(buf.data);
+	return true;
+
+fail:
+	free(scratch.data);
+	free(buf.data);
+	return false;
+}
+
+/**
+ * word_list_append - Appends a word to a WordList, taking ownership of it.
+ * @list: Pointer to the WordList structure.
+ * @word: The word to append, may be NULL on allocation failure.
+ * Return: true on success, false on allocation failure.
+ */
+bool word_list_append(WordList *list, char *word)
+{
+	if (!word)
+		return false;
+	if (list->count + 1 >= list->capacity) {
+		int capacity = list->capacity ? list->capacity * 2 : 8;
+		char **items = realloc(list->items, sizeof(char *) * capacity);
+		if (!items) {
+			free(word);
+			return false;
+		}
+		list->items = items;
+		list->capacity = capacity;
+	}
+	list->items[list->count++] = word;
+	list->items[list->count] = NULL;
+	return true;
+}
+
+/**
+ * word_list_free - Frees the words of a WordList and the list itself.
+ * @list: Pointer to the WordList structure.
+ */
+void word_list_free(WordList *list)
+{
+	for (int i = 0; i < list->count; i++)
+		free(list->items[i]);
+	free(list->items);
+	list->items = NULL;
+	list->count = 0;
+	list->capacity = 0;
+}
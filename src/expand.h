@@ -0,0 +1,28 @@
+#ifndef EXPAND_H
+#define EXPAND_H
+
+#include "arith.h"
+#include "shell.h"
+#include <stdbool.h>
+
+/* the lexer replaces '$' with these markers outside single quotes */
+#define EXPAND_VAR '\001'
+#define EXPAND_QUOTED_VAR '\002'
+/* and "$((expr))" with the expression between two of these */
+#define EXPAND_ARITH '\003'
+
+typedef struct WordList {
+	char **items;
+	int count;
+	int capacity;
+} WordList;
+
+bool expand_needed(const char *word);
+char *expand_word(ShellState *shell, const char *word, Arith **cache);
+char *expand_pattern(ShellState *shell, const char *word, Arith **cache);
+bool expand_fields(ShellState *shell, const char *word, WordList *list,
+		   Arith **cache);
+bool word_list_append(WordList *list, char *word);
+void word_list_free(WordList *list);
+
+#endif
@@ -0,0 +1,108 @@
+#include "functions.h"
+#include "intern.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * function_table_init - Initializes an empty function table.
+ * @functions: Pointer to the FunctionTable structure.
+ */
+void function_table_init(FunctionTable *functions)
+{
+	memset(functions, 0, sizeof(*functions));
+}
+
+/**
+ * function_find - Finds a function by name and hash.
+ * @functions: Pointer to the FunctionTable structure.
+ * @name: The function name.
+ * @hash: The hash of @name, as computed by intern_hash_bytes.
+ *
+ * Names are interned, so a call from the parsed tree usually matches the
+ * definition by pointer and the stored hash rules out other candidates.
+ *
+ * Return: The CMD_FUNCTION definition, or NULL if none is defined.
+ */
+Command *function_find(FunctionTable *functions, const char *name,
+		       unsigned int hash)
+{
+	Function *fn = functions->buckets[hash % FUNCTION_BUCKETS];
+
+	for (; fn; fn = fn->next) {
+		const char *defined = fn->definition->as.function.name;
+
+		if (defined == name ||
+		    (fn->hash == hash && strcmp(defined, name) == 0))
+			return fn->definition;
+	}
+	return NULL;
+}
+
+/**
+ * function_lookup - Finds a function by name.
+ * @functions: Pointer to the FunctionTable structure.
+ * @name: The function name.
+ * Return: The CMD_FUNCTION definition, or NULL if none is defined.
+ */
+Command *function_lookup(FunctionTable *functions, const char *name)
+{
+	return function_find(functions, name,
+			     intern_hash_bytes(name, strlen(name)));
+}
+
+/**
+ * function_define - Stores a function definition, replacing any other one.
+ * @functions: Pointer to the FunctionTable structure.
+ * @definition: The CMD_FUNCTION node.
+ *
+ * The table takes a reference to the parsed tree instead of copying it, so
+ * running a definition inside a loop costs no allocation after the first.
+ *
+ * Return: true on success, false on allocation failure.
+ */
+bool function_define(FunctionTable *functions, Command *definition)
+{
+	const char *name = definition->as.function.name;
+	unsigned int hash = intern_hash(name);
+	Function **link = &functions->buckets[hash % FUNCTION_BUCKETS];
+	Function *fn;
+
+	for (fn = *link; fn; fn = fn->next) {
+		if (fn->hash == hash &&
+		    strcmp(fn->definition->as.function.name, name) == 0)
+			break;
+	}
+	if (!fn) {
+		fn = malloc(sizeof(Function));
+		if (!fn)
+			return false;
+		fn->definition = NULL;
+		fn->hash = hash;
+		fn->next = *link;
+		*link = fn;
+	}
+
+	definition->as.function.refs++;
+	command_free(fn->definition);
+	fn->definition = definition;
+	return true;
+}
+
+/**
+ * function_table_free - Drops every function definition.
+ * @functions: Pointer to the FunctionTable structure.
+ */
+void function_table_free(FunctionTable *functions)
+{
+	for (size_t b = 0; b < FUNCTION_BUCKETS; b++) {
+		Function *fn = functions->buckets[b];
+
+		while (fn) {
+			Function *next = fn->next;
+			command_free(fn->definition);
+			free(fn);
+			fn = next;
+		}
+		functions->buckets[b] = NULL;
+	}
+}
@@ -0,0 +1,26 @@
+#ifndef FUNCTIONS_H
+#define FUNCTIONS_H
+
+#include "command.h"
+#include <stdbool.h>
+
+#define FUNCTION_BUCKETS 64
+
+typedef struct Function {
+	Command *definition;
+	unsigned int hash;
+	struct Function *next;
+} Function;
+
+typedef struct FunctionTable {
+	Function *buckets[FUNCTION_BUCKETS];
+} FunctionTable;
+
+void function_table_init(FunctionTable *functions);
+Command *function_find(FunctionTable *functions, const char *name,
+		       unsigned int hash);
+Command *function_lookup(FunctionTable *functions, const char *name);
+bool function_define(FunctionTable *functions, Command *definition);
+void function_table_free(FunctionTable *functions);
+
+#endif
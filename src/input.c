@@ -0,0 +1,241 @@
+#define _GNU_SOURCE
+
+#include "input.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* scratch pipe that tee(2) copies peeked pipe data into */
+static int peek_pipe[2] = { -1, -1 };
+
+/**
+ * input_reserve - Makes room for more data at the end of a line.
+ * @line: Pointer to the InputLine structure.
+ * @extra: Number of bytes needed, not counting the terminator.
+ * Return: true on success, false on allocation failure.
+ */
+static bool input_reserve(InputLine *line, size_t extra)
+{
+	if (line->length + extra + 1 <= line->capacity)
+		return true;
+
+	size_t capacity = (line->length + extra + 1) * 2;
+	char *data = realloc(line->data, capacity);
+	if (!data)
+		return false;
+	line->data = data;
+	line->capacity = capacity;
+	return true;
+}
+
+/**
+ * input_read_fully - Reads exactly the given number of bytes.
+ * @fd: The file descriptor.
+ * @buf: Where to store the bytes.
+ * @size: Number of bytes to read.
+ * Return: Number of bytes read, less than @size only at end of input, or
+ *         -1 on error.
+ */
+static ssize_t input_read_fully(int fd, char *buf, size_t size)
+{
+	size_t done = 0;
+
+	while (done < size) {
+		ssize_t n = read(fd, buf + done, size - done);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (n == 0)
+			break;
+		done += n;
+	}
+	return done;
+}
+
+/**
+ * input_peek - Looks at pending input without consuming it.
+ * @fd: The file descriptor, a socket or a pipe.
+ * @buf: Where to copy the data.
+ * @size: Maximum number of bytes to copy.
+ *
+ * Sockets are peeked with MSG_PEEK. On Linux, pipes are duplicated with
+ * tee(2) into a scratch pipe and read back from there.
+ *
+ * Return: Number of bytes copied, 0 at end of input, or -1 if the
+ *         descriptor cannot be peeked.
+ */
+static ssize_t input_peek(int fd, char *buf, size_t size)
+{
+	ssize_t n;
+
+	do {
+		n = recv(fd, buf, size, MSG_PEEK);
+	} while (n < 0 && errno == EINTR);
+	if (n >= 0 || errno != ENOTSOCK)
+		return n;
+
+#ifdef __linux__
+	if (peek_pipe[0] < 0 && pipe2(peek_pipe, O_CLOEXEC) < 0)
+		return -1;
+	do {
+		n = tee(fd, peek_pipe[1], size, 0);
+	} while (n < 0 && errno == EINTR);
+	if (n <= 0)
+		return n;
+	/* the scratch pipe must be left empty for the next peek */
+	if (input_read_fully(peek_pipe[0], buf, n) != n)
+		return -1;
+	return n;
+#else
+	return -1;
+#endif
+}
+
+/**
+ * input_read_seekable - Reads a line from a seekable descriptor.
+ * @fd: The file descriptor.
+ * @line: The InputLine to append to.
+ *
+ * Data is read in growing blocks; once the newline is found, the offset
+ * is moved back to the byte after it, as if only the line had been read.
+ *
+ * Return: 1 if a newline was found, 0 at end of input, -1 on error.
+ */
+static int input_read_seekable(int fd, InputLine *line)
+{
+	size_t block = INPUT_BLOCK_MIN;
+
+	for (;;) {
+		if (!input_reserve(line, block))
+			return -1;
+
+		char *start = line->data + line->length;
+		ssize_t n = read(fd, start, block);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (n == 0)
+			return 0;
+
+		char *newline = memchr(start, '\n', n);
+		if (newline) {
+			off_t excess = n - (newline - start + 1);
+			line->length += newline - start;
+			if (excess > 0 && lseek(fd, -excess, SEEK_CUR) < 0)
+				return -1;
+			return 1;
+		}
+		line->length += n;
+		if (block < INPUT_BLOCK_MAX)
+			block *= 2;
+	}
+}
+
+/**
+ * input_read_bytes - Reads a line one byte at a time.
+ * @fd: The file descriptor.
+ * @line: The InputLine to append to.
+ * Return: 1 if a newline was found, 0 at end of input, -1 on error.
+ */
+static int input_read_bytes(int fd, InputLine *line)
+{
+	for (;;) {
+		char c;
+		ssize_t n = read(fd, &c, 1);
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (n == 0)
+			return 0;
+		if (c == '\n')
+			return 1;
+		if (!input_reserve(line, 1))
+			return -1;
+		line->data[line->length++] = c;
+	}
+}
+
+/**
+ * input_read_peekable - Reads a line from a socket or pipe.
+ * @fd: The file descriptor.
+ * @line: The InputLine to append to.
+ *
+ * Pending data is peeked first so that exactly the bytes up to the newline
+ * are consumed; descriptors that cannot be peeked are read byte by byte.
+ *
+ * Return: 1 if a newline was found, 0 at end of input, -1 on error.
+ */
+static int input_read_peekable(int fd, InputLine *line)
+{
+	size_t block = INPUT_BLOCK_MIN;
+
+	for (;;) {
+		if (!input_reserve(line, block))
+			return -1;
+
+		char *start = line->data + line->length;
+		ssize_t n = input_peek(fd, start, block);
+		if (n < 0)
+			return input_read_bytes(fd, line);
+		if (n == 0)
+			return 0;
+
+		char *newline = memchr(start, '\n', n);
+		size_t take = newline ? (size_t)(newline - start + 1) :
+					(size_t)n;
+		if (input_read_fully(fd, start, take) != (ssize_t)take)
+			return -1;
+		if (newline) {
+			line->length += take - 1;
+			return 1;
+		}
+		line->length += take;
+		if (block < INPUT_BLOCK_MAX)
+			block *= 2;
+	}
+}
+
+/**
+ * input_read_line - Reads one line without consuming input beyond it.
+ * @fd: The file descriptor.
+ * @line: The InputLine the line is appended to, without its newline.
+ *
+ * POSIX requires the descriptor to be left just after the newline, so
+ * that commands run later see the rest of the input. Regular files are
+ * read in blocks and seeked back; pipes and sockets are peeked.
+ *
+ * Return: 1 if a whole line was read, 0 at end of input (a final line
+ *         without a newline may still have been read), -1 on error.
+ */
+int input_read_line(int fd, InputLine *line)
+{
+	struct stat st;
+	int status;
+
+	if (!input_reserve(line, 0))
+		return -1;
+
+	if (fstat(fd, &st) < 0)
+		status = input_read_bytes(fd, line);
+	else if (S_ISREG(st.st_mode))
+		status = input_read_seekable(fd, line);
+	else if (S_ISFIFO(st.st_mode) || S_ISSOCK(st.st_mode))
+		status = input_read_peekable(fd, line);
+	else
+		status = input_read_bytes(fd, line);
+
+	line->data[line->length] = '\0';
+	return status;
+}
@@ -0,0 +1,17 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stddef.h>
+
+#define INPUT_BLOCK_MIN 256
+#define INPUT_BLOCK_MAX 65536
+
+typedef struct InputLine {
+	char *data;
+	size_t length;
+	size_t capacity;
+} InputLine;
+
+int input_read_line(int fd, InputLine *line);
+
+#endif
@@ -0,0 +1,273 @@
+#include "intern.h"
+#include <stdlib.h>
+#include <string.h>
+
+static InternTable *intern_tables;
+static pthread_once_t intern_atfork_once = PTHREAD_ONCE_INIT;
+
+/**
+ * intern_entry - Finds the entry holding an interned string.
+ * @text: A string returned by intern_string.
+ * Return: Pointer to the InternString structure.
+ */
+static InternString *intern_entry(const char *text)
+{
+	return (InternString *)(text - offsetof(InternString, text));
+}
+
+/**
+ * intern_lock_all - Locks every table before a fork.
+ *
+ * The read-ahead thread may hold a table lock while the shell forks; the
+ * child would then deadlock on its first release.
+ */
+static void intern_lock_all(void)
+{
+	for (InternTable *table = intern_tables; table;
+	     table = table->next_table)
+		pthread_mutex_lock(&table->lock);
+}
+
+/**
+ * intern_unlock_all - Unlocks every table after a fork.
+ */
+static void intern_unlock_all(void)
+{
+	for (InternTable *table = intern_tables; table;
+	     table = table->next_table)
+		pthread_mutex_unlock(&table->lock);
+}
+
+/**
+ * intern_register_atfork - Installs the fork handlers, once per process.
+ */
+static void intern_register_atfork(void)
+{
+	pthread_atfork(intern_lock_all, intern_unlock_all, intern_unlock_all);
+}
+
+/**
+ * intern_table_new - Creates an empty intern table.
+ *
+ * Tables must be created and freed by the main thread.
+ *
+ * Return: Pointer to the InternTable, or NULL on allocation failure.
+ */
+InternTable *intern_table_new(void)
+{
+	InternTable *table = calloc(1, sizeof(InternTable));
+
+	if (!table)
+		return NULL;
+	pthread_once(&intern_atfork_once, intern_register_atfork);
+	pthread_mutex_init(&table->lock, NULL);
+	table->next_table = intern_tables;
+	intern_tables = table;
+	return table;
+}
+
+/**
+ * intern_hash_bytes - Computes the FNV-1a hash of a string.
+ * @text: The characters to hash.
+ * @length: Number of characters.
+ * Return: The hash.
+ */
+unsigned int intern_hash_bytes(const char *text, size_t length)
+{
+	unsigned int hash = 2166136261u;
+
+	for (size_t i = 0; i < length; i++)
+		hash = (hash ^ (unsigned char)text[i]) * 16777619u;
+	return hash;
+}
+
+/**
+ * intern_alloc - Allocates an entry holding a copy of a string.
+ * @text: The characters to copy.
+ * @length: Number of characters.
+ * @hash: The hash of @text.
+ * Return: Pointer to the new entry with one reference, or NULL.
+ */
+static InternString *intern_alloc(const char *text, size_t length,
+				  unsigned int hash)
+{
+	InternString *entry = malloc(sizeof(InternString) + length + 1);
+
+	if (!entry)
+		return NULL;
+	entry->table = NULL;
+	entry->next = NULL;
+	entry->older = NULL;
+	entry->newer = NULL;
+	entry->hash = hash;
+	entry->length = length;
+	entry->refs = 1;
+	memcpy(entry->text, text, length);
+	entry->text[length] = '\0';
+	return entry;
+}
+
+/**
+ * intern_lru_unlink - Removes an entry from the list of unused entries.
+ * @table: Pointer to the InternTable structure.
+ * @entry: The entry, whose last reference has just been taken again.
+ */
+static void intern_lru_unlink(InternTable *table, InternString *entry)
+{
+	if (entry->older)
+		entry->older->newer = entry->newer;
+	else
+		table->oldest = entry->newer;
+	if (entry->newer)
+		entry->newer->older = entry->older;
+	else
+		table->newest = entry->older;
+	entry->older = NULL;
+	entry->newer = NULL;
+}
+
+/**
+ * intern_lru_push - Appends an entry to the list of unused entries.
+ * @table: Pointer to the InternTable structure.
+ * @entry: The entry, whose last reference has just been released.
+ */
+static void intern_lru_push(InternTable *table, InternString *entry)
+{
+	entry->older = table->newest;
+	entry->newer = NULL;
+	if (table->newest)
+		table->newest->newer = entry;
+	else
+		table->oldest = entry;
+	table->newest = entry;
+}
+
+/**
+ * intern_evict - Frees the least recently used unreferenced entry.
+ * @table: Pointer to the InternTable structure, with an unused entry.
+ */
+static void intern_evict(InternTable *table)
+{
+	InternString *victim = table->oldest;
+	InternString **link =
+		&table->buckets[victim->hash & (INTERN_BUCKETS - 1)];
+
+	intern_lru_unlink(table, victim);
+	while (*link != victim)
+		link = &(*link)->next;
+	*link = victim->next;
+	table->count--;
+	free(victim);
+}
+
+/**
+ * intern_string - Returns the canonical copy of a string.
+ * @table: Pointer to the InternTable structure, may be NULL.
+ * @text: The characters of the string.
+ * @length: Number of characters.
+ *
+ * Strings up to INTERN_MAX_LENGTH bytes are shared: equal strings yield
+ * the same pointer. Longer strings, and short ones when every entry of a
+ * full table is in use, get a private copy. Either way the result carries
+ * its hash and is released with intern_release.
+ *
+ * Return: The string, or NULL on allocation failure.
+ */
+char *intern_string(InternTable *table, const char *text, size_t length)
+{
+	unsigned int hash = intern_hash_bytes(text, length);
+	InternString **bucket, *entry;
+
+	if (!table || length > INTERN_MAX_LENGTH) {
+		entry = intern_alloc(text, length, hash);
+		return entry ? entry->text : NULL;
+	}
+
+	pthread_mutex_lock(&table->lock);
+	bucket = &table->buckets[hash & (INTERN_BUCKETS - 1)];
+	for (entry = *bucket; entry; entry = entry->next) {
+		if (entry->hash == hash && entry->length == length &&
+		    memcmp(entry->text, text, length) == 0) {
+			if (entry->refs++ == 0)
+				intern_lru_unlink(table, entry);
+			pthread_mutex_unlock(&table->lock);
+			return entry->text;
+		}
+	}
+
+	if (table->count >= INTERN_MAX_ENTRIES && table->oldest)
+		intern_evict(table);
+	entry = intern_alloc(text, length, hash);
+	if (entry && table->count < INTERN_MAX_ENTRIES) {
+		entry->table = table;
+		entry->next = *bucket;
+		*bucket = entry;
+		table->count++;
+	}
+	pthread_mutex_unlock(&table->lock);
+	return entry ? entry->text : NULL;
+}
+
+/**
+ * intern_hash - Returns the hash stored with a string.
+ * @text: A string returned by intern_string.
+ * Return: The same value as intern_hash_bytes on the string.
+ */
+unsigned int intern_hash(const char *text)
+{
+	return intern_entry(text)->hash;
+}
+
+/**
+ * intern_release - Drops a reference to a string.
+ * @text: A string returned by intern_string, may be NULL.
+ *
+ * A shared string stays in its table once unused, so the next identical
+ * word costs no allocation, until it is evicted to make room.
+ */
+void intern_release(char *text)
+{
+	InternString *entry;
+	InternTable *table;
+
+	if (!text)
+		return;
+	entry = intern_entry(text);
+	table = entry->table;
+	if (!table) {
+		free(entry);
+		return;
+	}
+	pthread_mutex_lock(&table->lock);
+	if (--entry->refs == 0)
+		intern_lru_push(table, entry);
+	pthread_mutex_unlock(&table->lock);
+}
+
+/**
+ * intern_table_free - Frees an intern table and its strings.
+ * @table: Pointer to the InternTable structure, may be NULL.
+ *
+ * Every string of the table must have been released already.
+ */
+void intern_table_free(InternTable *table)
+{
+	InternTable **link = &intern_tables;
+
+	if (!table)
+		return;
+	while (*link != table)
+		link = &(*link)->next_table;
+	*link = table->next_table;
+
+	for (size_t i = 0; i < INTERN_BUCKETS; i++) {
+		InternString *entry = table->buckets[i];
+		while (entry) {
+			InternString *next = entry->next;
+			free(entry);
+			entry = next;
+		}
+	}
+	pthread_mutex_destroy(&table->lock);
+	free(table);
+}
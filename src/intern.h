@@ -0,0 +1,38 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <pthread.h>
+#include <stddef.h>
+
+#define INTERN_BUCKETS 1024
+#define INTERN_MAX_ENTRIES 4096
+#define INTERN_MAX_LENGTH 32
+
+typedef struct InternString {
+	struct InternTable *table;
+	struct InternString *next;
+	struct InternString *older;
+	struct InternString *newer;
+	unsigned int hash;
+	unsigned int length;
+	unsigned int refs;
+	char text[];
+} InternString;
+
+typedef struct InternTable {
+	pthread_mutex_t lock;
+	InternString *buckets[INTERN_BUCKETS];
+	InternString *oldest;
+	InternString *newest;
+	size_t count;
+	struct InternTable *next_table;
+} InternTable;
+
+InternTable *intern_table_new(void);
+unsigned int intern_hash_bytes(const char *text, size_t length);
+char *intern_string(InternTable *table, const char *text, size_t length);
+unsigned int intern_hash(const char *text);
+void intern_release(char *text);
+void intern_table_free(InternTable *table);
+
+#endif
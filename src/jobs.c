@@ -0,0 +1,243 @@
+#include "jobs.h"
+#include "counters.h"
+#include "executor.h"
+#include "output.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* finished jobs whose status is kept for "wait PID" */
+#define JOB_DONE_MAX 64
+
+/**
+ * job_implicit_slot_in_use - Checks if a job is running on the implicit slot.
+ * @shell: Pointer to the shell state.
+ * Return: true if a job holds no jobserver token, false otherwise.
+ */
+static bool job_implicit_slot_in_use(ShellState *shell)
+{
+	for (Job *job = shell->jobs; job; job = job->next) {
+		if (!job->done && !job->has_token)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * job_acquire_slot - Waits until a background job may be started.
+ * @shell: Pointer to the shell state.
+ * @has_token: Set to true if a jobserver token was taken.
+ * @token: Where to store the token byte taken.
+ *
+ * Like make, the shell owns one implicit slot which is handed to the first
+ * background job; every further job needs a token from the jobserver.
+ * Finished jobs are reaped while waiting so their tokens return to the pool.
+ *
+ * Return: true if the job may start, false on jobserver failure.
+ */
+bool job_acquire_slot(ShellState *shell, bool *has_token, char *token)
+{
+	*has_token = false;
+	if (!shell->jobserver.is_active)
+		return true;
+
+	for (;;) {
+		job_reap(shell, false);
+		if (!job_implicit_slot_in_use(shell))
+			return true;
+
+		int got = jobserver_acquire(&shell->jobserver, token, 100);
+		if (got > 0) {
+			*has_token = true;
+			return true;
+		}
+		if (got < 0)
+			return false;
+	}
+}
+
+/**
+ * job_release_slot - Returns a slot taken by job_acquire_slot.
+ * @shell: Pointer to the shell state.
+ * @has_token: Whether a jobserver token was taken.
+ * @token: The token byte taken.
+ */
+void job_release_slot(ShellState *shell, bool has_token, char token)
+{
+	if (has_token && shell->jobserver.is_active)
+		jobserver_release(&shell->jobserver, token);
+}
+
+/**
+ * job_add - Records a new background job.
+ * @shell: Pointer to the shell state.
+ * @pid: Process ID of the job.
+ * @has_token: Whether the job holds a jobserver token.
+ * @token: The token byte held by the job.
+ *
+ * Return: Pointer to the new Job, or NULL on failure.
+ */
+Job *job_add(ShellState *shell, pid_t pid, bool has_token, char token)
+{
+	Job *job = malloc(sizeof(Job));
+	Job **tail = &shell->jobs;
+	int id = 1;
+
+	if (!job)
+		return NULL;
+
+	while (*tail) {
+		if ((*tail)->id >= id)
+			id = (*tail)->id + 1;
+		tail = &(*tail)->next;
+	}
+
+	job->id = id;
+	job->pid = pid;
+	job->has_token = has_token;
+	job->token = token;
+	job->done = false;
+	job->status = 0;
+	job->next = NULL;
+	*tail = job;
+	counter_add(COUNTER_JOBS_STARTED, 1);
+	return job;
+}
+
+/**
+ * job_collect - Checks if a job has finished and releases its slot.
+ * @shell: Pointer to the shell state.
+ * @job: The job, which must still be running.
+ * @block: Wait for the job to finish instead of polling.
+ * Return: true if the job is now done, false if it is still running.
+ */
+static bool job_collect(ShellState *shell, Job *job, bool block)
+{
+	int status;
+	pid_t pid;
+
+	do {
+		pid = waitpid(job->pid, &status, block ? 0 : WNOHANG);
+	} while (pid < 0 && errno == EINTR);
+
+	/* the job only gives up its token once it is really gone */
+	if (pid == 0 || (pid < 0 && errno != ECHILD))
+		return false;
+
+	job->done = true;
+	job->status = pid < 0 ? 127 : execute_wait_status(status);
+	job_release_slot(shell, job->has_token, job->token);
+	if (shell->is_interactive_mode)
+		output_printf(STDERR_FILENO, "[%d] Done\n", job->id);
+	counter_add(COUNTER_JOBS_FINISHED, 1);
+	return true;
+}
+
+/**
+ * job_remove - Unlinks and frees a job.
+ * @link: The link pointing to the job.
+ */
+static void job_remove(Job **link)
+{
+	Job *job = *link;
+
+	*link = job->next;
+	free(job);
+}
+
+/**
+ * job_reap - Collects finished background jobs and releases their slots.
+ * @shell: Pointer to the shell state.
+ * @block: Wait for every job to finish instead of polling.
+ *
+ * Finished jobs stay listed so that "wait PID" can report their status;
+ * beyond JOB_DONE_MAX of them, the oldest ones are forgotten.
+ */
+void job_reap(ShellState *shell, bool block)
+{
+	Job **link = &shell->jobs;
+	int done = 0;
+
+	for (Job *job = shell->jobs; job; job = job->next) {
+		if (job->done || job_collect(shell, job, block))
+			done++;
+	}
+	while (*link && done > JOB_DONE_MAX) {
+		if ((*link)->done) {
+			job_remove(link);
+			done--;
+		} else {
+			link = &(*link)->next;
+		}
+	}
+}
+
+/**
+ * job_pending - Checks if any background job is still running.
+ * @shell: Pointer to the shell state.
+ * Return: true if a job has not been reaped yet, false otherwise.
+ */
+bool job_pending(ShellState *shell)
+{
+	for (Job *job = shell->jobs; job; job = job->next) {
+		if (!job->done)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * job_wait - Waits for one background job and forgets it.
+ * @shell: Pointer to the shell state.
+ * @pid: Process ID of the job.
+ * Return: The exit status of the job, or 127 if it is not a known job.
+ */
+int job_wait(ShellState *shell, pid_t pid)
+{
+	Job **link = &shell->jobs;
+	int status;
+
+	while (*link && (*link)->pid != pid)
+		link = &(*link)->next;
+	if (!*link)
+		return 127;
+	while (!(*link)->done && !job_collect(shell, *link, true))
+		;
+	status = (*link)->status;
+	job_remove(link);
+	return status;
+}
+
+/**
+ * job_forget_done - Drops the jobs that have finished.
+ * @shell: Pointer to the shell state.
+ */
+void job_forget_done(ShellState *shell)
+{
+	Job **link = &shell->jobs;
+
+	while (*link) {
+		if ((*link)->done)
+			job_remove(link);
+		else
+			link = &(*link)->next;
+	}
+}
+
+/**
+ * job_free_list - Frees the job list without waiting for the jobs.
+ * @shell: Pointer to the shell state.
+ */
+void job_free_list(ShellState *shell)
+{
+	Job *job = shell->jobs;
+
+	while (job) {
+		Job *next = job->next;
+		free(job);
+		job = next;
+	}
+	shell->jobs = NULL;
+}
@@ -0,0 +1,27 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include "shell.h"
+#include <stdbool.h>
+#include <sys/types.h>
+
+typedef struct Job {
+	int id;
+	pid_t pid;
+	bool has_token;
+	char token;
+	bool done;
+	int status;
+	struct Job *next;
+} Job;
+
+bool job_acquire_slot(ShellState *shell, bool *has_token, char *token);
+void job_release_slot(ShellState *shell, bool has_token, char token);
+Job *job_add(ShellState *shell, pid_t pid, bool has_token, char token);
+void job_reap(ShellState *shell, bool block);
+bool job_pending(ShellState *shell);
+int job_wait(ShellState *shell, pid_t pid);
+void job_forget_done(ShellState *shell);
+void job_free_list(ShellState *shell);
+
+#endif
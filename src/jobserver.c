@@ -0,0 +1,245 @@
+#include "jobserver.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * jobserver_fd_is_valid - Checks if a file descriptor is open.
+ * @fd: The file descriptor to check.
+ * Return: true if the descriptor is open, false otherwise.
+ */
+static bool jobserver_fd_is_valid(int fd)
+{
+	return fd >= 0 && fcntl(fd, F_GETFD) != -1;
+}
+
+/**
+ * jobserver_find_auth - Finds the jobserver option in a MAKEFLAGS value.
+ * @makeflags: The MAKEFLAGS string.
+ *
+ * Return: Pointer to the option value, or NULL if none is present.
+ */
+static const char *jobserver_find_auth(const char *makeflags)
+{
+	static const char *const options[] = { "--jobserver-auth=",
+					       "--jobserver-fds=" };
+	const char *found = NULL;
+
+	for (size_t i = 0; i < sizeof(options) / sizeof(options[0]); i++) {
+		const char *p = makeflags;
+		const char *match;
+
+		/* make honours the last occurrence, so do the same */
+		while ((match = strstr(p, options[i])) != NULL) {
+			found = match + strlen(options[i]);
+			p = found;
+		}
+		if (found)
+			return found;
+	}
+	return NULL;
+}
+
+/**
+ * jobserver_open_nonblock - Opens a private non-blocking read descriptor.
+ * @js: Pointer to the JobServer structure, with read_fd set.
+ *
+ * Setting O_NONBLOCK on read_fd, or on a dup of it, would change the file
+ * description shared with make and every other client. Reopening the pipe
+ * through /proc gives a description of our own instead. Without /proc,
+ * nonblock_fd stays -1 and reads fall back to blocking ones.
+ */
+static void jobserver_open_nonblock(JobServer *js)
+{
+	char path[64];
+
+	snprintf(path, sizeof(path), "/proc/self/fd/%d", js->read_fd);
+	js->nonblock_fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+}
+
+/**
+ * jobserver_init_client - Attaches to a jobserver advertised in MAKEFLAGS.
+ * @js: Pointer to the JobServer structure.
+ *
+ * Both the "fifo:PATH" form and the "R,W" descriptor pair form are
+ * understood. A descriptor pair that is not open in this process (make
+ * did not consider us a sub-make) is ignored.
+ *
+ * Return: true if a jobserver was attached, false otherwise.
+ */
+bool jobserver_init_client(JobServer *js)
+{
+	const char *makeflags = getenv("MAKEFLAGS");
+	const char *auth;
+	int rfd, wfd;
+
+	js->is_active = false;
+	js->is_server = false;
+	js->read_fd = -1;
+	js->write_fd = -1;
+	js->nonblock_fd = -1;
+
+	if (!makeflags)
+		return false;
+	auth = jobserver_find_auth(makeflags);
+	if (!auth)
+		return false;
+
+	if (strncmp(auth, "fifo:", 5) == 0) {
+		size_t len = strcspn(auth + 5, " \t");
+		char *path = strndup(auth + 5, len);
+		if (!path)
+			return false;
+		rfd = open(path, O_RDWR | O_CLOEXEC);
+		free(path);
+		if (rfd < 0)
+			return false;
+		js->read_fd = rfd;
+		js->write_fd = rfd;
+	} else {
+		if (sscanf(auth, "%d,%d", &rfd, &wfd) != 2)
+			return false;
+		if (!jobserver_fd_is_valid(rfd) || !jobserver_fd_is_valid(wfd))
+			return false;
+		js->read_fd = rfd;
+		js->write_fd = wfd;
+	}
+	jobserver_open_nonblock(js);
+	js->is_active = true;
+	return true;
+}
+
+/**
+ * jobserver_init_server - Creates a jobserver with the given number of slots.
+ * @js: Pointer to the JobServer structure.
+ * @slots: Total number of concurrent jobs allowed, including the implicit one.
+ *
+ * The pipe is left inheritable and advertised in MAKEFLAGS so that nested
+ * make and hsh invocations share the same limit.
+ *
+ * Return: true on success, false otherwise.
+ */
+bool jobserver_init_server(JobServer *js, int slots)
+{
+	int fds[2];
+	char flags[64];
+
+	js->is_active = false;
+	js->is_server = false;
+	js->read_fd = -1;
+	js->write_fd = -1;
+	js->nonblock_fd = -1;
+
+	if (slots < 1 || pipe(fds) < 0)
+		return false;
+
+	for (int i = 1; i < slots; i++) {
+		if (write(fds[1], "+", 1) != 1) {
+			close(fds[0]);
+			close(fds[1]);
+			return false;
+		}
+	}
+
+	snprintf(flags, sizeof(flags), " -j%d --jobserver-auth=%d,%d", slots,
+		 fds[0], fds[1]);
+	if (setenv("MAKEFLAGS", flags, 1) < 0) {
+		close(fds[0]);
+		close(fds[1]);
+		return false;
+	}
+
+	js->read_fd = fds[0];
+	js->write_fd = fds[1];
+	jobserver_open_nonblock(js);
+	js->is_server = true;
+	js->is_active = true;
+	return true;
+}
+
+/**
+ * jobserver_sigchld - SIGCHLD handler used to interrupt a blocking read.
+ * @sig: The signal number.
+ */
+static void jobserver_sigchld(int sig)
+{
+	(void)sig;
+}
+
+/**
+ * jobserver_acquire - Takes one token from the jobserver.
+ * @js: Pointer to the JobServer structure.
+ * @token: Where to store the token byte read.
+ * @timeout_ms: Maximum time to wait for the descriptor to become readable.
+ *
+ * Another process may take the token between poll() and read(), so the
+ * read goes through the private non-blocking descriptor and an empty pipe
+ * just counts as a timeout. Without one, the read is done with a SIGCHLD
+ * handler installed without SA_RESTART, so that losing the race does not
+ * block us while one of our own children is waiting to be reaped.
+ *
+ * Return: 1 if a token was taken, 0 on timeout or interruption, -1 on error.
+ */
+int jobserver_acquire(JobServer *js, char *token, int timeout_ms)
+{
+	int fd = js->nonblock_fd >= 0 ? js->nonblock_fd : js->read_fd;
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	struct sigaction sa, old;
+	ssize_t n;
+	int ready;
+
+	ready = poll(&pfd, 1, timeout_ms);
+	if (ready < 0)
+		return errno == EINTR ? 0 : -1;
+	if (ready == 0)
+		return 0;
+
+	if (fd == js->nonblock_fd) {
+		n = read(fd, token, 1);
+	} else {
+		memset(&sa, 0, sizeof(sa));
+		sa.sa_handler = jobserver_sigchld;
+		sigemptyset(&sa.sa_mask);
+		sigaction(SIGCHLD, &sa, &old);
+		n = read(fd, token, 1);
+		sigaction(SIGCHLD, &old, NULL);
+	}
+
+	if (n == 1)
+		return 1;
+	if (n < 0 && (errno == EINTR || errno == EAGAIN))
+		return 0;
+	return -1;
+}
+
+/**
+ * jobserver_release - Returns a token to the jobserver.
+ * @js: Pointer to the JobServer structure.
+ * @token: The token byte previously acquired.
+ */
+void jobserver_release(JobServer *js, char token)
+{
+	while (write(js->write_fd, &token, 1) < 0 && errno == EINTR)
+		;
+}
+
+/**
+ * jobserver_close - Detaches from the jobserver.
+ * @js: Pointer to the JobServer structure.
+ */
+void jobserver_close(JobServer *js)
+{
+	if (!js->is_active)
+		return;
+	if (js->nonblock_fd >= 0)
+		close(js->nonblock_fd);
+	if (js->read_fd != js->write_fd)
+		close(js->write_fd);
+	close(js->read_fd);
+	js->is_active = false;
+}
@@ -0,0 +1,20 @@
+#ifndef JOBSERVER_H
+#define JOBSERVER_H
+
+#include <stdbool.h>
+
+typedef struct JobServer {
+	bool is_active;
+	bool is_server;
+	int read_fd;
+	int write_fd;
+	int nonblock_fd;
+} JobServer;
+
+bool jobserver_init_client(JobServer *js);
+bool jobserver_init_server(JobServer *js, int slots);
+int jobserver_acquire(JobServer *js, char *token, int timeout_ms);
+void jobserver_release(JobServer *js, char token);
+void jobserver_close(JobServer *js);
+
+#endif
@@ -1,18 +1,22 @@
 #include "lexer.h"
-#include <stdarg.h>
+#include "expand.h"
+#include "intern.h"
+#include "output.h"
+#include <ctype.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 /**
  * lexer_at_end - Checks if the lexer has reached the end of the source.
  * @lex: Pointer to the Lexer structure.
  *
- * Return: true if at end, false otherwise.
+ * Return: true if at end or between chunks, false otherwise.
  */
 static bool lexer_at_end(Lexer *lex)
 {
-	return lex->source[lex->cursor] == '\0';
+	return !lex->source || lex->source[lex->cursor] == '\0';
 }
 /**
  * lexer_advance - Advances the lexer cursor and returns the current character.
@@ -77,13 +81,18 @@ static void lexer_append_token(Lexer *lex, TokenType type, char *lexeme)
 {
 	Token *token = malloc(sizeof(Token));
 	if (!token) {
-		fprintf(stderr, "Error: malloc failed\n");
+		output_printf(STDERR_FILENO, "Error: malloc failed\n");
 		lex->shell->fatal_error = true;
 		return;
 	}
 	token->type = type;
 	token->lexeme = lexeme;
 	token->next = NULL;
+	lex->pending_operator = false;
+	lex->function_header = false;
+	if (type != TOKEN_ASSIGNMENT_WORD)
+		lex->command_start = !(type == TOKEN_WORD ||
+				       token_is_redirection(type));
 
 	if (lex->last == NULL) {
 		lex->tokens = token;
@@ -122,113 +131,350 @@ static bool is_valid_identifier(char *str, size_t length)
  */
 static bool is_word_delimiter(char c)
 {
-	return strchr(" \r\t\n;|&<>#", c) != NULL;
+	return strchr(" \r\t\n;|&<>()", c) != NULL;
 }
 
 /**
- * append_substr - Appends a formatted substring to a dynamic string.
- * @string: Pointer to the dynamic string.
- * @length: Pointer to the current length of the string.
- * @capacity: Pointer to the current capacity of the string.
- * @format: The format string.
- * @...: Additional arguments for formatting.
+ * lexer_word_append - Appends characters to the word being lexed.
+ * @lex: Pointer to the Lexer structure.
+ * @str: The characters to append.
+ * @length: Number of characters to append.
+ *
+ * Return: true on success, false on allocation failure.
  */
-static void append_substr(char **string, size_t *length, size_t *capacity,
-			  const char *format, ...)
+static bool lexer_word_append(Lexer *lex, const char *str, size_t length)
 {
-	va_list args;
-	char buffer[2];
-	int needed;
-
-	va_start(args, format);
-	needed = vsnprintf(buffer, sizeof(buffer), format, args);
-	va_end(args);
-
-	if (*length + needed + 1 > *capacity) {
-		*capacity = (*length + needed + 1) * 2;
-		*string = realloc(*string, *capacity);
-		if (!*string) {
-			fprintf(stderr, "Error: realloc failed\n");
-			return;
+	if (lex->word_length + length + 1 > lex->word_capacity) {
+		size_t capacity = (lex->word_length + length + 1) * 2;
+		char *word = realloc(lex->word, capacity);
+		if (!word) {
+			output_printf(STDERR_FILENO, "Error: realloc failed\n");
+			lex->shell->fatal_error = true;
+			return false;
 		}
+		lex->word = word;
+		lex->word_capacity = capacity;
 	}
+	memcpy(lex->word + lex->word_length, str, length);
+	lex->word_length += length;
+	lex->word[lex->word_length] = '\0';
+	lex->has_word = true;
+	return true;
+}
 
-	va_start(args, format);
-	vsnprintf(*string + *length, needed + 1, format, args);
-	va_end(args);
-	*length += needed;
+/**
+ * lexer_word_append_quoted - Appends quoted characters to the current word.
+ * @lex: Pointer to the Lexer structure.
+ * @str: The characters to append.
+ * @length: Number of characters to append.
+ *
+ * In a case pattern, quoted glob characters match themselves, so they are
+ * escaped with a backslash for the pattern compiler.
+ *
+ * Return: true on success, false on allocation failure.
+ */
+static bool lexer_word_append_quoted(Lexer *lex, const char *str,
+				     size_t length)
+{
+	if (!lex->case_pattern)
+		return lexer_word_append(lex, str, length);
+
+	while (length > 0) {
+		size_t span = strcspn(str, "*?[\\");
+		if (span > length)
+			span = length;
+		if (!lexer_word_append(lex, str, span))
+			return false;
+		if (span == length)
+			return true;
+		if (!lexer_word_append(lex, "\\", 1) ||
+		    !lexer_word_append(lex, str + span, 1))
+			return false;
+		str += span + 1;
+		length -= span + 1;
+	}
+	return true;
 }
 
 /**
- * lexer_handle_word - Handles the lexing of a word token.
+ * lexer_is_marker - Checks if a character of a word is an expansion marker.
+ * @c: The character.
+ * Return: true for EXPAND_VAR and EXPAND_QUOTED_VAR.
+ */
+static bool lexer_is_marker(char c)
+{
+	return c == EXPAND_VAR || c == EXPAND_QUOTED_VAR;
+}
+
+/**
+ * lexer_mark_expansions - Marks the '$' characters just appended to a word.
  * @lex: Pointer to the Lexer structure.
+ * @length: Number of characters appended.
+ * @marker: EXPAND_VAR or EXPAND_QUOTED_VAR.
+ *
+ * A '$' right after a marker, as in "$$" or "${$}", is the name of the
+ * special parameter and stays as it is for expand_parameter.
  */
-static void lexer_handle_word(Lexer *lex)
+static void lexer_mark_expansions(Lexer *lex, size_t length, char marker)
+{
+	char *end = lex->word + lex->word_length;
+	char *p = end - length;
+
+	while ((p = memchr(p, '$', end - p)) != NULL) {
+		bool name = (p > lex->word && lexer_is_marker(p[-1])) ||
+			    (p - lex->word > 1 && p[-1] == '{' &&
+			     lexer_is_marker(p[-2]));
+
+		if (!name)
+			*p = marker;
+		p++;
+	}
+}
+
+/**
+ * lexer_find_arith_end - Finds the closing "))" of an arithmetic expansion.
+ * @expr: Pointer to the text following "$((".
+ * Return: Pointer to the closing "))", or NULL if it is missing.
+ */
+static const char *lexer_find_arith_end(const char *expr)
 {
-	char *string = strdup("");
-	size_t length = 0;
-	size_t capacity = 0;
-	bool has_quotes_before_equal = false, found_equals = false;
+	int depth = 0;
+
+	for (const char *p = expr; *p; p++) {
+		if (*p == '(') {
+			depth++;
+		} else if (*p == ')') {
+			if (depth == 0)
+				return p[1] == ')' ? p : NULL;
+			depth--;
+		}
+	}
+	return NULL;
+}
 
+/**
+ * lexer_handle_arith - Copies a $((...)) expansion into the current word.
+ * @lex: Pointer to the Lexer structure, with the cursor on the '$'.
+ *
+ * The expression is stored between two EXPAND_ARITH markers, verbatim:
+ * '$' characters inside it are left for the arithmetic compiler.
+ *
+ * Return: true on success, false on a missing "))" or allocation failure.
+ */
+static bool lexer_handle_arith(Lexer *lex)
+{
+	const char *expr = &lex->source[lex->cursor + 3];
+	const char *end = lexer_find_arith_end(expr);
+	const char marker = EXPAND_ARITH;
+
+	if (!end) {
+		output_printf(STDERR_FILENO,
+			      "%s: %d: Syntax error: Missing '))'\n",
+			      lex->shell->name, lex->shell->line_number);
+		lex->shell->had_error = true;
+		lex->cursor += strlen(&lex->source[lex->cursor]);
+		return false;
+	}
+	if (!lexer_word_append(lex, &marker, 1) ||
+	    !lexer_word_append(lex, expr, end - expr) ||
+	    !lexer_word_append(lex, &marker, 1))
+		return false;
+	lex->cursor = end + 2 - lex->source;
+	return true;
+}
+
+/**
+ * lexer_track_compound - Tracks the nesting of compound commands.
+ * @lex: Pointer to the Lexer structure.
+ * @word: A word found where a command name is expected.
+ *
+ * The depth lets the shell ask for continuation lines until every
+ * compound command opened so far has been closed.
+ */
+static void lexer_track_compound(Lexer *lex, const char *word)
+{
+	static const char *const openers[] = { "if", "while", "until", "{" };
+	static const char *const separators[] = { "then", "do", "else",
+						  "elif", "!", "time" };
+	static const char *const closers[] = { "fi", "done", "}", "esac" };
+
+	for (size_t i = 0; i < sizeof(openers) / sizeof(openers[0]); i++) {
+		if (strcmp(word, openers[i]) == 0) {
+			lex->depth++;
+			lex->command_start = true;
+			return;
+		}
+	}
+	for (size_t i = 0; i < sizeof(separators) / sizeof(separators[0]);
+	     i++) {
+		if (strcmp(word, separators[i]) == 0) {
+			lex->command_start = true;
+			return;
+		}
+	}
+	for (size_t i = 0; i < sizeof(closers) / sizeof(closers[0]); i++) {
+		if (strcmp(word, closers[i]) == 0) {
+			if (lex->depth > 0)
+				lex->depth--;
+			return;
+		}
+	}
+	if (strcmp(word, "for") == 0) {
+		lex->depth++;
+	} else if (strcmp(word, "case") == 0) {
+		lex->depth++;
+		lex->case_header = 2;
+	}
+}
+
+/**
+ * lexer_finish_word - Turns the completed word into a token.
+ * @lex: Pointer to the Lexer structure.
+ *
+ * The token gets an interned copy of the word and the buffer is kept for
+ * the next one, so a word seen before costs no allocation.
+ */
+static void lexer_finish_word(Lexer *lex)
+{
+	bool at_command_start = lex->command_start;
+	char *string;
+	size_t equ_pos;
+
+	lex->in_word = false;
+	if (!lex->has_word)
+		return;
+
+	string = intern_string(lex->shell->strings, lex->word,
+			       lex->word_length);
+	lex->has_word = false;
+	lex->word_length = 0;
 	if (!string) {
-		fprintf(stderr, "Error: malloc failed\n");
+		output_printf(STDERR_FILENO, "Error: malloc failed\n");
 		lex->shell->fatal_error = true;
 		return;
 	}
 
-	while (!lexer_at_end(lex) && !is_word_delimiter(lexer_peek(lex))) {
-		if (lexer_peek(lex) == '\'' || lexer_peek(lex) == '"') {
-			lex->start = lex->cursor;
-			char quote = lexer_advance(lex);
-			while (!lexer_at_end(lex) && lexer_peek(lex) != quote)
-				lexer_advance(lex);
-
-			if (lexer_at_end(lex)) {
-				fprintf(stderr,
-					"Error: Unterminated string.\n");
-				lex->shell->had_error = true;
-				free(string);
-				return;
+	/*
+	 * a lone digit right before '<' or '>' names the descriptor; between
+	 * chunks the fed line may be gone, and nothing follows the word
+	 */
+	if (lex->source && isdigit((unsigned char)string[0]) &&
+	    string[1] == '\0' && !lex->quoted &&
+	    (lexer_peek(lex) == '<' || lexer_peek(lex) == '>')) {
+		lexer_append_token(lex, TOKEN_IO_NUMBER, string);
+		return;
+	}
+
+	equ_pos = strcspn(string, "=");
+	if (string[equ_pos] == '=' && !lex->has_quotes_before_equal &&
+	    equ_pos > 0 && is_valid_identifier(string, equ_pos)) {
+		lexer_append_token(lex, TOKEN_ASSIGNMENT_WORD, string);
+		return;
+	}
+	lexer_append_token(lex, TOKEN_WORD, string);
+	if (lex->case_header > 0) {
+		/* the word after "case", then "in"; patterns follow */
+		lex->case_pattern = --lex->case_header == 0;
+	} else if (lex->case_pattern) {
+		if (!lex->quoted && strcmp(string, "esac") == 0) {
+			lex->case_pattern = false;
+			if (lex->depth > 0)
+				lex->depth--;
+		}
+	} else if (at_command_start && !lex->quoted) {
+		lexer_track_compound(lex, string);
+	}
+}
+
+/**
+ * lexer_handle_word - Handles the lexing of a word token.
+ * @lex: Pointer to the Lexer structure.
+ *
+ * A quoted string that is still open at the end of the source leaves the
+ * lexer inside the word; the next call to lexer_feed resumes scanning it
+ * right after the text already consumed, so no input is scanned twice.
+ */
+static void lexer_handle_word(Lexer *lex)
+{
+	if (!lex->in_word) {
+		lex->in_word = true;
+		lex->quote = '\0';
+		lex->found_equals = false;
+		lex->has_quotes_before_equal = false;
+		lex->quoted = false;
+	}
+
+	for (;;) {
+		const char *rest = &lex->source[lex->cursor];
+
+		if (lex->quote) {
+			const char *close = strchr(rest, lex->quote);
+			size_t span = close ? (size_t)(close - rest) :
+					      strlen(rest);
+			const char *arith = NULL;
+
+			if (lex->quote == '"') {
+				arith = strstr(rest, "$((");
+				if (arith && (size_t)(arith - rest) < span)
+					span = arith - rest;
+				else
+					arith = NULL;
 			}
 
-			if (!found_equals)
-				has_quotes_before_equal = true;
+			size_t before = lex->word_length;
+			if (!lexer_word_append_quoted(lex, rest, span))
+				return;
+			if (lex->quote == '"')
+				lexer_mark_expansions(lex,
+						      lex->word_length - before,
+						      EXPAND_QUOTED_VAR);
+			lex->cursor += span;
+			if (arith) {
+				if (!lexer_handle_arith(lex))
+					return;
+				continue;
+			}
+			if (!close)
+				return;
 			lexer_advance(lex);
+			lex->quote = '\0';
+			continue;
+		}
 
-			size_t str_length = lex->cursor - lex->start - 2;
-			char *substr = malloc(str_length + 1);
-			if (!substr) {
-				fprintf(stderr, "Error: malloc failed\n");
-				lex->shell->fatal_error = true;
-				free(string);
+		if (lexer_at_end(lex) || is_word_delimiter(lexer_peek(lex)))
+			break;
+
+		if (*rest == '\'' || *rest == '"') {
+			if (!lex->found_equals)
+				lex->has_quotes_before_equal = true;
+			lex->quoted = true;
+			lex->quote = lexer_advance(lex);
+			/* an empty quoted string still makes a word */
+			if (!lexer_word_append(lex, "", 0))
 				return;
-			}
+			continue;
+		}
 
-			strncpy(substr, &lex->source[lex->start + 1],
-				str_length);
-			substr[str_length] = '\0';
-			append_substr(&string, &length, &capacity, "%s",
-				      substr);
-			free(substr);
-		} else {
-			if (lexer_peek(lex) == '=' && !found_equals)
-				found_equals = true;
-			append_substr(&string, &length, &capacity, "%c",
-				      lexer_advance(lex));
+		if (strncmp(rest, "$((", 3) == 0) {
+			if (!lexer_handle_arith(lex))
+				return;
+			continue;
 		}
-	}
 
-	if (strcmp(string, "") != 0) {
-		size_t equ_pos = strcspn(string, "=");
-		if (strchr(string, '=') && !has_quotes_before_equal &&
-		    equ_pos > 0 && is_valid_identifier(string, equ_pos)) {
-			lexer_append_token(lex, TOKEN_ASSIGNMENT_WORD, string);
+		size_t span = strcspn(rest, " \r\t\n;|&<>()'\"");
+		/* leave a "$((" that ends the span to lexer_handle_arith */
+		if (span > 0 && rest[span] == '(' && rest[span - 1] == '$' &&
+		    rest[span + 1] == '(')
+			span--;
+		if (!lex->found_equals && memchr(rest, '=', span))
+			lex->found_equals = true;
+		if (!lexer_word_append(lex, rest, span))
 			return;
-		}
-		lexer_append_token(lex, TOKEN_WORD, string);
-	} else {
-		free(string);
+		lexer_mark_expansions(lex, span, EXPAND_VAR);
+		lex->cursor += span;
 	}
+
+	lexer_finish_word(lex);
 }
 
 /**
@@ -242,16 +488,31 @@ static void lexer_scan_token(Lexer *lex)
 	switch (c) {
 	case ';':
 		lexer_advance(lex);
-		lexer_append_token(lex, TOKEN_SEMICOLON, ";");
+		if (lexer_match(lex, ';')) {
+			lexer_append_token(lex, TOKEN_DSEMI, ";;");
+			lex->case_pattern = true;
+		} else {
+			lexer_append_token(lex, TOKEN_SEMICOLON, ";");
+		}
 		break;
 	case '<':
 		lexer_advance(lex);
-		lexer_append_token(lex, TOKEN_REDIRECT_IN, "<");
+		if (lexer_match(lex, '&'))
+			lexer_append_token(lex, TOKEN_REDIRECT_DUP_IN, "<&");
+		else if (lexer_match(lex, '>'))
+			lexer_append_token(lex, TOKEN_REDIRECT_READ_WRITE,
+					   "<>");
+		else
+			lexer_append_token(lex, TOKEN_REDIRECT_IN, "<");
 		break;
 	case '>':
 		lexer_advance(lex);
 		if (lexer_match(lex, '>'))
 			lexer_append_token(lex, TOKEN_REDIRECT_APPEND, ">>");
+		else if (lexer_match(lex, '&'))
+			lexer_append_token(lex, TOKEN_REDIRECT_DUP_OUT, ">&");
+		else if (lexer_match(lex, '|'))
+			lexer_append_token(lex, TOKEN_REDIRECT_OUT, ">|");
 		else
 			lexer_append_token(lex, TOKEN_REDIRECT_OUT, ">");
 		break;
@@ -269,8 +530,41 @@ static void lexer_scan_token(Lexer *lex)
 		else
 			lexer_append_token(lex, TOKEN_PIPE, "|");
 		break;
+	case '(':
+		/* a subshell, unlike "name()" or a case pattern, stays open
+		 * across lines until its ')' */
+		if (lex->command_start && !lex->case_pattern) {
+			lex->subshells++;
+			lex->depth++;
+		}
+		lexer_advance(lex);
+		lexer_append_token(lex, TOKEN_LPAREN, "(");
+		break;
+	case ')': {
+		bool header = lex->last && lex->last->type == TOKEN_LPAREN;
+
+		if (lex->subshells > 0 && !lex->case_pattern) {
+			lex->subshells--;
+			if (lex->depth > 0)
+				lex->depth--;
+		}
+		lexer_advance(lex);
+		lexer_append_token(lex, TOKEN_RPAREN, ")");
+		lex->function_header = header;
+		lex->case_pattern = false;
+		break;
+	}
 	case '\n':
 		lexer_advance(lex);
+		/* a trailing |, && or || continues on the next line, and so
+		 * does "name()" when the function body starts on the next */
+		if (lex->function_header ||
+		    (lex->last && (lex->last->type == TOKEN_PIPE ||
+				   lex->last->type == TOKEN_AND ||
+				   lex->last->type == TOKEN_OR))) {
+			lex->pending_operator = true;
+			break;
+		}
 		lexer_append_token(lex, TOKEN_EOL, "\n");
 		break;
 	case '#':
@@ -283,6 +577,103 @@ static void lexer_scan_token(Lexer *lex)
 		break;
 	}
 }
+/**
+ * lexer_init - Initializes a lexer that can be fed input in chunks.
+ * @lex: Pointer to the Lexer structure.
+ * @shell: Pointer to the shell state.
+ */
+void lexer_init(Lexer *lex, ShellState *shell)
+{
+	lex->source = NULL;
+	lex->start = 0;
+	lex->cursor = 0;
+	lex->tokens = NULL;
+	lex->last = NULL;
+	lex->shell = shell;
+	lex->word = NULL;
+	lex->word_length = 0;
+	lex->word_capacity = 0;
+	lex->quote = '\0';
+	lex->in_word = false;
+	lex->has_word = false;
+	lex->found_equals = false;
+	lex->has_quotes_before_equal = false;
+	lex->quoted = false;
+	lex->pending_operator = false;
+	lex->function_header = false;
+	lex->command_start = true;
+	lex->case_pattern = false;
+	lex->case_header = 0;
+	lex->subshells = 0;
+	lex->depth = 0;
+}
+
+/**
+ * lexer_feed - Tokenizes the next chunk of input.
+ * @lex: Pointer to the Lexer structure.
+ * @input: The chunk to tokenize, usually one line.
+ *
+ * Tokens accumulate in the lexer until lexer_finish is called. If the chunk
+ * ends inside a quoted string, after a |, && or || operator, or inside a
+ * compound command, the lexer keeps its state and lexer_needs_more returns
+ * true. @input is not used after this returns, so the caller may free it.
+ */
+void lexer_feed(Lexer *lex, const char *input)
+{
+	lex->source = input;
+	lex->start = 0;
+	lex->cursor = 0;
+
+	if (lex->in_word)
+		lexer_handle_word(lex);
+
+	while (!lexer_at_end(lex) && !lex->shell->fatal_error) {
+		lexer_skip_blanks(lex);
+		lex->start = lex->cursor;
+		lexer_scan_token(lex);
+	}
+	lex->source = NULL;
+	lex->start = 0;
+	lex->cursor = 0;
+}
+
+/**
+ * lexer_needs_more - Checks if the input so far is an incomplete command.
+ * @lex: Pointer to the Lexer structure.
+ * Return: true if a continuation line is expected, false otherwise.
+ */
+bool lexer_needs_more(Lexer *lex)
+{
+	return lex->quote != '\0' || lex->pending_operator || lex->depth > 0;
+}
+
+/**
+ * lexer_finish - Returns the tokens lexed so far and resets the lexer.
+ * @lex: Pointer to the Lexer structure.
+ *
+ * A quoted string still open at this point is reported as an error. The
+ * list is terminated by a TOKEN_EOF token.
+ *
+ * Return: Pointer to the head of the token list.
+ */
+Token *lexer_finish(Lexer *lex)
+{
+	Token *tokens;
+
+	if (lex->quote) {
+		output_printf(STDERR_FILENO, "Error: Unterminated string.\n");
+		lex->shell->had_error = true;
+	} else if (lex->in_word) {
+		lexer_finish_word(lex);
+	}
+	lexer_append_token(lex, TOKEN_EOF, "");
+	tokens = lex->tokens;
+	free(lex->word);
+
+	lexer_init(lex, lex->shell);
+	return tokens;
+}
+
 /**
  * tokenize - Tokenizes the input string into a linked list of tokens.
  * @shell: Pointer to the shell state.
@@ -292,18 +683,9 @@ static void lexer_scan_token(Lexer *lex)
  */
 Token *tokenize(ShellState *shell, const char *input)
 {
-	Lexer lex = { .source = input,
-		      .start = 0,
-		      .cursor = 0,
-		      .tokens = NULL,
-		      .last = NULL,
-		      .shell = shell };
-
-	while (!lexer_at_end(&lex)) {
-		lexer_skip_blanks(&lex);
-		lex.start = lex.cursor;
-		lexer_scan_token(&lex);
-	}
+	Lexer lex;
 
-	return lex.tokens;
+	lexer_init(&lex, shell);
+	lexer_feed(&lex, input);
+	return lexer_finish(&lex);
 }
@@ -11,8 +11,28 @@ typedef struct Lexer {
 	Token *tokens;
 	Token *last;
 	ShellState *shell;
+	char *word;
+	size_t word_length;
+	size_t word_capacity;
+	char quote;
+	bool in_word;
+	bool has_word;
+	bool found_equals;
+	bool has_quotes_before_equal;
+	bool quoted;
+	bool pending_operator;
+	bool function_header;
+	bool command_start;
+	bool case_pattern;
+	int case_header;
+	int subshells;
+	int depth;
 } Lexer;
 
+void lexer_init(Lexer *lex, ShellState *shell);
+void lexer_feed(Lexer *lex, const char *input);
+bool lexer_needs_more(Lexer *lex);
+Token *lexer_finish(Lexer *lex);
 Token *tokenize(ShellState *shell, const char *input);
 
 #endif
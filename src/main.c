@@ -1,39 +1,198 @@
+#include "bench.h"
+#include "command.h"
+#include "output.h"
+#include "parallel.h"
 #include "shell.h"
+#include <fcntl.h>
+#include <getopt.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
+/**
+ * usage - Prints the usage message.
+ * @progname: Name of the shell executable.
+ * Return: The exit status to use.
+ */
+static int usage(const char *progname)
+{
+	output_printf(STDERR_FILENO,
+		      "Usage: %s [-j jobs] [-P lines [--keep-order]] "
+		      "[--bench=runs] [--read-ahead] "
+		      "[-c command [name] | filename] [arg ...]\n",
+		      progname);
+	output_flush(STDERR_FILENO);
+	return 127;
+}
+
+/**
+ * open_script - Opens a script file out of the way of redirections.
+ * @file: Path of the script.
+ *
+ * The descriptor is moved above those a redirection may name and is
+ * closed on exec, so commands neither inherit nor clobber it.
+ *
+ * Return: The stream, or NULL on failure.
+ */
+static FILE *open_script(const char *file)
+{
+	int fd = open(file, O_RDONLY | O_CLOEXEC);
+	FILE *stream;
+	int moved;
+
+	if (fd < 0)
+		return NULL;
+	moved = fcntl(fd, F_DUPFD_CLOEXEC, REDIRECT_MAX_FD + 1);
+	close(fd);
+	if (moved < 0)
+		return NULL;
+	stream = fdopen(moved, "r");
+	if (!stream)
+		close(moved);
+	return stream;
+}
+
+/**
+ * shell_run - Runs a script, or benchmarks it when runs is positive.
+ * @shell: Pointer to the shell state.
+ * @stream: The script.
+ * @runs: Number of benchmark runs, or 0.
+ */
+static void shell_run(ShellState *shell, FILE *stream, int runs)
+{
+	if (runs > 0)
+		shell->last_status = bench_run(shell, stream, runs);
+	else
+		shell_repl(shell, stream);
+	if (shell->parallel)
+		parallel_finish(shell->parallel, shell);
+}
+
 int main(int argc, char **argv)
 {
-	if (argc > 2) {
-		fprintf(stderr, "Usage: %s [filename]\n", argv[0]);
-		return 127;
+	static const struct option long_options[] = {
+		{ "bench", required_argument, NULL, 'b' },
+		{ "read-ahead", no_argument, NULL, 'r' },
+		{ "keep-order", no_argument, NULL, 'k' },
+		{ NULL, 0, NULL, 0 },
+	};
+	char *command = NULL;
+	int jobs = 0;
+	int runs = 0;
+	int parallel = 0;
+	bool read_ahead = false;
+	bool keep_order = false;
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "+c:j:P:", long_options, NULL)) !=
+	       -1) {
+		switch (opt) {
+		case 'b':
+			runs = atoi(optarg);
+			if (runs < 1)
+				return usage(argv[0]);
+			break;
+		case 'r':
+			read_ahead = true;
+			break;
+		case 'k':
+			keep_order = true;
+			break;
+		case 'P':
+			parallel = atoi(optarg);
+			if (parallel < 1)
+				return usage(argv[0]);
+			break;
+		case 'c':
+			command = optarg;
+			break;
+		case 'j':
+			jobs = atoi(optarg);
+			if (jobs < 1)
+				return usage(argv[0]);
+			break;
+		default:
+			return usage(argv[0]);
+		}
 	}
 
-	char *name = argc == 1 ? argv[0] : argv[1];
-	bool is_interactive = (argc == 1 && isatty(STDIN_FILENO));
+	/* the script, or the name given after -c, becomes $0 */
+	char *file = !command && optind < argc ? argv[optind++] : NULL;
+	char *name = argv[0];
+	if (file)
+		name = file;
+	else if (command && optind < argc)
+		name = argv[optind++];
+	bool is_interactive = (!file && !command && isatty(STDIN_FILENO));
+	if (runs > 0 && is_interactive)
+		return usage(argv[0]);
+	/* lines only run side by side when read from a script */
+	if (parallel > 0 && (runs > 0 || is_interactive))
+		return usage(argv[0]);
 
 	ShellState *shell = shell_init(name, is_interactive);
 
 	if (!shell) {
-		fprintf(stderr, "Error: malloc failed\n");
+		output_printf(STDERR_FILENO, "Error: malloc failed\n");
+		output_flush(STDERR_FILENO);
 		return 127;
 	}
 
-	if (argc == 2) {
-		FILE *stream = fopen(argv[1], "r");
+	shell->read_ahead = read_ahead;
+	if (parallel > 1) {
+		shell->parallel = parallel_new(parallel, keep_order);
+		if (!shell->parallel) {
+			output_printf(STDERR_FILENO, "Error: malloc failed\n");
+			shell_free(shell);
+			return 127;
+		}
+	}
+	shell->positional = argv + optind;
+	shell->positional_count = argc - optind;
+
+	if (jobs > 0) {
+		/* an explicit -j starts a new jobserver, as make does */
+		jobserver_close(&shell->jobserver);
+		if (!jobserver_init_server(&shell->jobserver, jobs)) {
+			output_printf(STDERR_FILENO,
+				      "Error: cannot create jobserver\n");
+			shell_free(shell);
+			return 127;
+		}
+		/* children get their environment from the variable table */
+		if (!var_set(&shell->vars, "MAKEFLAGS", getenv("MAKEFLAGS"),
+			     true)) {
+			output_printf(STDERR_FILENO, "Error: malloc failed\n");
+			shell_free(shell);
+			return 127;
+		}
+	}
+
+	if (command) {
+		FILE *stream = fmemopen(command, strlen(command), "r");
 		if (!stream) {
-			fprintf(stderr, "Error: cannot open file %s\n",
-				argv[1]);
+			output_printf(STDERR_FILENO, "Error: malloc failed\n");
 			shell_free(shell);
 			return 127;
 		}
-		shell_repl(shell, stream);
+		shell_run(shell, stream, runs);
+		fclose(stream);
+	} else if (file) {
+		FILE *stream = open_script(file);
+		if (!stream) {
+			output_printf(STDERR_FILENO,
+				      "Error: cannot open file %s\n", file);
+			shell_free(shell);
+			return 127;
+		}
+		shell_run(shell, stream, runs);
 		fclose(stream);
 	} else {
-		shell_repl(shell, stdin);
+		shell_run(shell, stdin, runs);
 	}
 
-	int exit_code = shell->fatal_error ? 2 : 0;
+	int exit_code = shell->fatal_error ? 2 : shell->last_status;
 	shell_free(shell);
 	return exit_code;
 }
@@ -0,0 +1,307 @@
+#define _GNU_SOURCE
+
+#include "metrics.h"
+#include "counters.h"
+#include "output.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct MetricCounter {
+	const char *name;
+	const char *unit;
+	const char *help;
+	CounterId id;
+} MetricCounter;
+
+static const MetricCounter metric_counters[] = {
+	{ "hsh_lines_parsed", NULL, "Input lines read.", COUNTER_LINES },
+	{ "hsh_parse_errors", NULL, "Commands rejected by the lexer or parser.",
+	  COUNTER_PARSE_ERRORS },
+	{ "hsh_spawns", NULL, "Processes forked to run commands.",
+	  COUNTER_SPAWNS },
+	{ "hsh_execs", NULL, "Programs started with execve.", COUNTER_EXECS },
+	{ "hsh_builtin_calls", NULL, "Builtin commands run.",
+	  COUNTER_BUILTINS },
+	{ "hsh_jobs_started", NULL, "Background jobs started.",
+	  COUNTER_JOBS_STARTED },
+	{ "hsh_jobs_finished", NULL, "Background jobs reaped.",
+	  COUNTER_JOBS_FINISHED },
+	{ "hsh_direct_syscalls", NULL,
+	  "System calls made directly by the shell, not inside libc.",
+	  COUNTER_DIRECT_SYSCALLS },
+	{ "hsh_allocations", NULL, "Allocation calls made by the shell.",
+	  COUNTER_ALLOCATIONS },
+	{ "hsh_allocated_bytes", "bytes", "Bytes requested by the shell.",
+	  COUNTER_ALLOCATED_BYTES },
+};
+
+/**
+ * metrics_format_histogram - Writes the spawn latency histogram.
+ * @out: The stream to write to.
+ * @now: The counter values.
+ */
+static void metrics_format_histogram(FILE *out, const Counters *now)
+{
+	const char *name = "hsh_spawn_latency_seconds";
+	unsigned long cumulative = 0;
+
+	fprintf(out, "# TYPE %s histogram\n", name);
+	fprintf(out, "# UNIT %s seconds\n", name);
+	fprintf(out, "# HELP %s Time spent in fork by the shell.\n", name);
+	for (int i = 0; i < COUNTER_LATENCY_BUCKETS; i++) {
+		long long bound = counter_latency_bound(i);
+
+		cumulative += now->spawn_latency[i];
+		if (bound < 0)
+			fprintf(out, "%s_bucket{le=\"+Inf\"} %lu\n", name,
+				cumulative);
+		else
+			fprintf(out, "%s_bucket{le=\"%g\"} %lu\n", name,
+				bound / 1e9, cumulative);
+	}
+	fprintf(out, "%s_sum %.9f\n", name,
+		now->values[COUNTER_SPAWN_NANOSECONDS] / 1e9);
+	fprintf(out, "%s_count %lu\n", name, cumulative);
+}
+
+/**
+ * metrics_format - Formats the counters in OpenMetrics text format.
+ * @length: Receives the length of the text.
+ *
+ * Every counter is read with one relaxed atomic load, so the values are
+ * not an exact snapshot of a single instant.
+ *
+ * Return: Newly allocated text, or NULL on allocation failure.
+ */
+char *metrics_format(size_t *length)
+{
+	char *text = NULL;
+	FILE *out = open_memstream(&text, length);
+	Counters now;
+
+	if (!out)
+		return NULL;
+	counters_snapshot(&now);
+
+	for (size_t i = 0; i < sizeof(metric_counters) /
+				       sizeof(metric_counters[0]);
+	     i++) {
+		const MetricCounter *metric = &metric_counters[i];
+
+		fprintf(out, "# TYPE %s counter\n", metric->name);
+		if (metric->unit)
+			fprintf(out, "# UNIT %s %s\n", metric->name,
+				metric->unit);
+		fprintf(out, "# HELP %s %s\n", metric->name, metric->help);
+		fprintf(out, "%s_total %lu\n", metric->name,
+			now.values[metric->id]);
+	}
+
+	fputs("# TYPE hsh_jobs_running gauge\n"
+	      "# HELP hsh_jobs_running Background jobs not yet reaped.\n",
+	      out);
+	fprintf(out, "hsh_jobs_running %lu\n",
+		now.values[COUNTER_JOBS_STARTED] -
+			now.values[COUNTER_JOBS_FINISHED]);
+
+	fputs("# TYPE hsh_path_lookups counter\n"
+	      "# HELP hsh_path_lookups Command names searched in PATH.\n",
+	      out);
+	fprintf(out, "hsh_path_lookups_total{result=\"found\"} %lu\n",
+		now.values[COUNTER_PATH_FOUND]);
+	fprintf(out, "hsh_path_lookups_total{result=\"not_found\"} %lu\n",
+		now.values[COUNTER_PATH_NOT_FOUND]);
+
+	metrics_format_histogram(out, &now);
+	fputs("# EOF\n", out);
+
+	if (fclose(out) != 0) {
+		free(text);
+		return NULL;
+	}
+	return text;
+}
+
+/**
+ * metrics_write_all - Writes a whole buffer to a descriptor.
+ * @fd: The descriptor.
+ * @data: The bytes to write.
+ * @length: Number of bytes.
+ * Return: true on success, false on a write error.
+ */
+static bool metrics_write_all(int fd, const char *data, size_t length)
+{
+	while (length > 0) {
+		ssize_t n = write(fd, data, length);
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		data += n;
+		length -= n;
+	}
+	return true;
+}
+
+/**
+ * metrics_write_file - Replaces a file with the current metrics.
+ * @path: The file to replace.
+ *
+ * The metrics are written to a temporary file next to @path and renamed
+ * over it, so a reader never sees a partial file.
+ *
+ * Return: true on success, false with errno set otherwise.
+ */
+bool metrics_write_file(const char *path)
+{
+	static const char suffix[] = ".XXXXXX";
+	size_t path_length = strlen(path), length;
+	char *temp = malloc(path_length + sizeof(suffix));
+	char *text = metrics_format(&length);
+	bool ok = false;
+	int fd = -1;
+
+	if (temp && text) {
+		memcpy(temp, path, path_length);
+		memcpy(temp + path_length, suffix, sizeof(suffix));
+		fd = mkostemp(temp, O_CLOEXEC);
+	}
+	if (fd >= 0) {
+		ok = fchmod(fd, 0644) == 0 &&
+		     metrics_write_all(fd, text, length);
+		ok = close(fd) == 0 && ok;
+		ok = ok && rename(temp, path) == 0;
+		if (!ok) {
+			int saved = errno;
+			unlink(temp);
+			errno = saved;
+		}
+	}
+	free(text);
+	free(temp);
+	return ok;
+}
+
+/**
+ * metrics_main - Rewrites the metrics file periodically.
+ * @arg: Pointer to the MetricsExporter structure.
+ * Return: NULL.
+ */
+static void *metrics_main(void *arg)
+{
+	MetricsExporter *exporter = arg;
+	struct timespec deadline;
+
+	pthread_mutex_lock(&exporter->lock);
+	while (!exporter->stop) {
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		deadline.tv_sec += exporter->interval;
+		while (!exporter->stop &&
+		       pthread_cond_timedwait(&exporter->changed,
+					      &exporter->lock,
+					      &deadline) != ETIMEDOUT)
+			;
+		if (exporter->stop)
+			break;
+		pthread_mutex_unlock(&exporter->lock);
+		metrics_write_file(exporter->path);
+		pthread_mutex_lock(&exporter->lock);
+	}
+	pthread_mutex_unlock(&exporter->lock);
+	return NULL;
+}
+
+/**
+ * metrics_exporter_free - Frees an exporter whose thread is not running.
+ * @exporter: Pointer to the MetricsExporter structure.
+ */
+static void metrics_exporter_free(MetricsExporter *exporter)
+{
+	pthread_cond_destroy(&exporter->changed);
+	pthread_mutex_destroy(&exporter->lock);
+	free(exporter->path);
+	free(exporter);
+}
+
+/**
+ * metrics_start - Starts exporting metrics to the file in HSH_METRICS_FILE.
+ * @name: Name of the shell, for error messages.
+ *
+ * The file is written once right away, so a bad path is reported at
+ * startup, then every HSH_METRICS_INTERVAL seconds by a helper thread that
+ * only reads the counters. Signals stay with the shell's own thread.
+ *
+ * Return: The exporter, or NULL if none is configured or it failed.
+ */
+MetricsExporter *metrics_start(const char *name)
+{
+	const char *path = getenv("HSH_METRICS_FILE");
+	const char *interval = getenv("HSH_METRICS_INTERVAL");
+	MetricsExporter *exporter;
+	pthread_condattr_t attr;
+	sigset_t all, saved;
+	bool started;
+
+	if (!path || !*path)
+		return NULL;
+	if (!metrics_write_file(path)) {
+		output_printf(STDERR_FILENO, "%s: %s: %s\n", name, path,
+			      strerror(errno));
+		output_flush(STDERR_FILENO);
+		return NULL;
+	}
+
+	exporter = calloc(1, sizeof(MetricsExporter));
+	if (!exporter)
+		return NULL;
+	exporter->interval = interval ? atoi(interval) : 0;
+	if (exporter->interval <= 0)
+		exporter->interval = METRICS_INTERVAL;
+	exporter->path = strdup(path);
+	pthread_mutex_init(&exporter->lock, NULL);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&exporter->changed, &attr);
+	pthread_condattr_destroy(&attr);
+	if (!exporter->path) {
+		metrics_exporter_free(exporter);
+		return NULL;
+	}
+
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &saved);
+	started = pthread_create(&exporter->thread, NULL, metrics_main,
+				 exporter) == 0;
+	pthread_sigmask(SIG_SETMASK, &saved, NULL);
+	if (!started) {
+		metrics_exporter_free(exporter);
+		return NULL;
+	}
+	return exporter;
+}
+
+/**
+ * metrics_stop - Stops exporting and writes the final metrics.
+ * @exporter: Pointer to the MetricsExporter structure, may be NULL.
+ */
+void metrics_stop(MetricsExporter *exporter)
+{
+	if (!exporter)
+		return;
+	pthread_mutex_lock(&exporter->lock);
+	exporter->stop = true;
+	pthread_cond_signal(&exporter->changed);
+	pthread_mutex_unlock(&exporter->lock);
+	pthread_join(exporter->thread, NULL);
+	metrics_write_file(exporter->path);
+	metrics_exporter_free(exporter);
+}
@@ -0,0 +1,24 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define METRICS_INTERVAL 15
+
+typedef struct MetricsExporter {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	bool stop;
+	int interval;
+	char *path;
+} MetricsExporter;
+
+char *metrics_format(size_t *length);
+bool metrics_write_file(const char *path);
+MetricsExporter *metrics_start(const char *name);
+void metrics_stop(MetricsExporter *exporter);
+
+#endif
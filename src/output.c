@@ -0,0 +1,223 @@
+#include "output.h"
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* each thread buffers separately; only the main thread's output is kept */
+static _Thread_local OutputBuffer *buffers[OUTPUT_MAX_FD];
+/* the only descriptor that may have buffered data; see output_switch */
+static _Thread_local int output_last = -1;
+
+/**
+ * output_write_all - Writes a whole buffer to a descriptor.
+ * @fd: The file descriptor.
+ * @data: The data to write.
+ * @length: Number of bytes to write.
+ * Return: true on success, false on a write error such as EBADF or EIO.
+ */
+static bool output_write_all(int fd, const char *data, size_t length)
+{
+	while (length > 0) {
+		ssize_t n = write(fd, data, length);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		data += n;
+		length -= n;
+	}
+	return true;
+}
+
+/**
+ * output_buffer - Returns the buffer for a descriptor, allocating it.
+ * @fd: The file descriptor.
+ * Return: Pointer to the buffer, or NULL if the descriptor is unbuffered.
+ */
+static OutputBuffer *output_buffer(int fd)
+{
+	if (fd < 0 || fd >= OUTPUT_MAX_FD)
+		return NULL;
+	if (!buffers[fd]) {
+		buffers[fd] = malloc(sizeof(OutputBuffer));
+		if (buffers[fd])
+			buffers[fd]->length = 0;
+	}
+	return buffers[fd];
+}
+
+/**
+ * output_flush - Writes out any data buffered for a descriptor.
+ * @fd: The file descriptor.
+ *
+ * The buffer is emptied even if the write fails, so the data is not sent
+ * to whatever the descriptor refers to next.
+ *
+ * Return: true on success, false if the data could not be written.
+ */
+bool output_flush(int fd)
+{
+	OutputBuffer *buf;
+	bool ok = true;
+
+	if (fd < 0 || fd >= OUTPUT_MAX_FD || !buffers[fd])
+		return true;
+	buf = buffers[fd];
+	if (buf->length > 0) {
+		ok = output_write_all(fd, buf->data, buf->length);
+		buf->length = 0;
+	}
+	return ok;
+}
+
+/**
+ * output_switch - Flushes the buffer of the last descriptor written to.
+ * @fd: The descriptor about to be written to.
+ *
+ * Standard output and standard error often refer to the same file, so
+ * data is only ever buffered for one descriptor at a time; everything
+ * then reaches the files in the order it was written.
+ */
+static void output_switch(int fd)
+{
+	if (fd == output_last)
+		return;
+	output_flush(output_last);
+	output_last = fd;
+}
+
+/**
+ * output_flush_all - Writes out the buffers of every descriptor.
+ *
+ * Must be called before forking, before changing what a descriptor refers
+ * to, and before blocking on input that may depend on pending output.
+ *
+ * Return: true on success, false if any buffer could not be written.
+ */
+bool output_flush_all(void)
+{
+	bool ok = true;
+
+	for (int fd = 0; fd < OUTPUT_MAX_FD; fd++)
+		ok = output_flush(fd) && ok;
+	return ok;
+}
+
+/**
+ * output_discard_all - Drops the buffers of the calling thread unwritten.
+ *
+ * Used by helper threads, whose diagnostics are reported again by the
+ * main thread when it redoes their work.
+ */
+void output_discard_all(void)
+{
+	for (int fd = 0; fd < OUTPUT_MAX_FD; fd++) {
+		free(buffers[fd]);
+		buffers[fd] = NULL;
+	}
+	output_last = -1;
+}
+
+/**
+ * output_write - Appends data to the buffer of a descriptor.
+ * @fd: The file descriptor.
+ * @data: The data to write.
+ * @length: Number of bytes to write.
+ *
+ * Writes larger than the buffer bypass it after flushing what is pending.
+ */
+void output_write(int fd, const char *data, size_t length)
+{
+	OutputBuffer *buf = output_buffer(fd);
+
+	output_switch(fd);
+	if (!buf) {
+		output_write_all(fd, data, length);
+		return;
+	}
+	if (buf->length + length > OUTPUT_BUFSIZE) {
+		output_flush(fd);
+		if (length >= OUTPUT_BUFSIZE) {
+			output_write_all(fd, data, length);
+			return;
+		}
+	}
+	memcpy(buf->data + buf->length, data, length);
+	buf->length += length;
+}
+
+/**
+ * output_putc - Appends a character to the buffer of a descriptor.
+ * @fd: The file descriptor.
+ * @c: The character to write.
+ */
+void output_putc(int fd, char c)
+{
+	OutputBuffer *buf = output_buffer(fd);
+
+	if (buf && fd == output_last && buf->length < OUTPUT_BUFSIZE) {
+		buf->data[buf->length++] = c;
+		return;
+	}
+	output_write(fd, &c, 1);
+}
+
+/**
+ * output_puts - Appends a string to the buffer of a descriptor.
+ * @fd: The file descriptor.
+ * @str: The string to write.
+ */
+void output_puts(int fd, const char *str)
+{
+	output_write(fd, str, strlen(str));
+}
+
+/**
+ * output_printf - Appends formatted output to the buffer of a descriptor.
+ * @fd: The file descriptor.
+ * @format: The format string.
+ * @...: Additional arguments for formatting.
+ */
+void output_printf(int fd, const char *format, ...)
+{
+	OutputBuffer *buf = output_buffer(fd);
+	char small[256];
+	va_list args;
+	int needed;
+
+	output_switch(fd);
+	if (buf && buf->length < OUTPUT_BUFSIZE) {
+		size_t room = OUTPUT_BUFSIZE - buf->length;
+
+		va_start(args, format);
+		needed = vsnprintf(buf->data + buf->length, room, format, args);
+		va_end(args);
+		if (needed >= 0 && (size_t)needed < room) {
+			buf->length += needed;
+			return;
+		}
+	} else {
+		va_start(args, format);
+		needed = vsnprintf(small, sizeof(small), format, args);
+		va_end(args);
+		if (needed >= 0 && (size_t)needed < sizeof(small)) {
+			output_write(fd, small, needed);
+			return;
+		}
+	}
+	if (needed < 0)
+		return;
+
+	char *big = malloc(needed + 1);
+	if (!big)
+		return;
+	va_start(args, format);
+	vsnprintf(big, needed + 1, format, args);
+	va_end(args);
+	output_write(fd, big, needed);
+	free(big);
+}
@@ -0,0 +1,24 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define OUTPUT_MAX_FD 10
+#define OUTPUT_BUFSIZE 8192
+
+typedef struct OutputBuffer {
+	size_t length;
+	char data[OUTPUT_BUFSIZE];
+} OutputBuffer;
+
+void output_write(int fd, const char *data, size_t length);
+void output_putc(int fd, char c);
+void output_puts(int fd, const char *str);
+void output_printf(int fd, const char *format, ...)
+	__attribute__((format(printf, 2, 3)));
+bool output_flush(int fd);
+bool output_flush_all(void);
+void output_discard_all(void);
+
+#endif
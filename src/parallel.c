@@ -0,0 +1,422 @@
+#define _GNU_SOURCE
+
+#include "parallel.h"
+#include "executor.h"
+#include "output.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* how often children without a pidfd are polled, in milliseconds */
+#define PARALLEL_POLL_MS 10
+
+/* output buffered per line in keep_order mode before the line must wait */
+#define PARALLEL_BUFFER_MAX (1024 * 1024)
+
+/**
+ * parallel_new - Creates a pool running up to @size lines at once.
+ * @size: Maximum number of children running at once.
+ * @keep_order: true to buffer the output of each line and write it in
+ *              input order.
+ * Return: Pointer to the Parallel structure, or NULL on allocation failure.
+ */
+Parallel *parallel_new(int size, bool keep_order)
+{
+	Parallel *pool = calloc(1, sizeof(Parallel));
+
+	if (!pool)
+		return NULL;
+	pool->slots = calloc(size, sizeof(ParallelSlot));
+	pool->polls = calloc(size * 2, sizeof(struct pollfd));
+	if (!pool->slots || !pool->polls) {
+		parallel_free(pool);
+		return NULL;
+	}
+	pool->size = size;
+	pool->keep_order = keep_order;
+	return pool;
+}
+
+/**
+ * parallel_pidfd - Opens a descriptor that polls readable once @pid exits.
+ * @pid: Process ID of a child.
+ * Return: The descriptor, or -1 where pidfds are not supported.
+ */
+static int parallel_pidfd(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+	return syscall(SYS_pidfd_open, pid, 0);
+#else
+	(void)pid;
+	return -1;
+#endif
+}
+
+/**
+ * parallel_read - Drains the output pipe of a child into its buffer.
+ * @slot: Pointer to the ParallelSlot structure.
+ *
+ * The pipe is closed at end of file, once the line and everything it
+ * started has closed its standard output. Reading stops while the buffer
+ * holds PARALLEL_BUFFER_MAX bytes; the line then blocks on the full pipe
+ * until the lines before it are done and its buffer is written out.
+ */
+static void parallel_read(ParallelSlot *slot)
+{
+	for (;;) {
+		ssize_t n;
+
+		if (slot->length >= PARALLEL_BUFFER_MAX)
+			return;
+		if (slot->capacity - slot->length < OUTPUT_BUFSIZE &&
+		    slot->capacity < PARALLEL_BUFFER_MAX) {
+			size_t capacity = slot->capacity * 2 + OUTPUT_BUFSIZE;
+			char *buffer;
+
+			if (capacity > PARALLEL_BUFFER_MAX)
+				capacity = PARALLEL_BUFFER_MAX;
+			buffer = realloc(slot->buffer, capacity);
+			if (!buffer)
+				break;
+			slot->buffer = buffer;
+			slot->capacity = capacity;
+		}
+		n = read(slot->output, slot->buffer + slot->length,
+			 slot->capacity - slot->length);
+		if (n > 0) {
+			slot->length += n;
+			continue;
+		}
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && errno == EAGAIN)
+			return;
+		break;
+	}
+	close(slot->output);
+	slot->output = -1;
+}
+
+/**
+ * parallel_reap - Collects the exit status of a child that has exited.
+ * @pool: Pointer to the Parallel structure.
+ * @slot: Pointer to the ParallelSlot structure of a running child.
+ */
+static void parallel_reap(Parallel *pool, ParallelSlot *slot)
+{
+	int status = 0, result;
+	pid_t pid = waitpid(slot->pid, &status, WNOHANG);
+
+	if (pid == 0 || (pid < 0 && errno == EINTR))
+		return;
+	result = pid < 0 ? 1 : execute_wait_status(status);
+	slot->status = result;
+	slot->exited = true;
+	if (slot->pidfd >= 0) {
+		close(slot->pidfd);
+		slot->pidfd = -1;
+	}
+	/* $? after the batch is the status of its last line */
+	if (slot->sequence + 1 == pool->next_sequence)
+		pool->last_status = result;
+}
+
+/**
+ * parallel_report - Reports a line that failed.
+ * @shell: Pointer to the shell state.
+ * @line_number: Line the command was read from.
+ * @status: Its non-zero exit status.
+ */
+static void parallel_report(ShellState *shell, int line_number, int status)
+{
+	output_printf(STDERR_FILENO, "%s: %d: exit status %d\n", shell->name,
+		      line_number, status);
+}
+
+/**
+ * parallel_report_ready - Reports the failed lines whose turn has come.
+ * @pool: Pointer to the Parallel structure.
+ * @shell: Pointer to the shell state.
+ *
+ * A failure is reported once every line before it has finished, so the
+ * reports come in line order however the lines finish.
+ */
+static void parallel_report_ready(Parallel *pool, ShellState *shell)
+{
+	unsigned long oldest = pool->next_sequence;
+	size_t done = 0;
+
+	for (int i = 0; i < pool->size; i++) {
+		if (pool->slots[i].pid && pool->slots[i].sequence < oldest)
+			oldest = pool->slots[i].sequence;
+	}
+	while (done < pool->failure_count &&
+	       pool->failures[done].sequence < oldest) {
+		parallel_report(shell, pool->failures[done].line_number,
+				pool->failures[done].status);
+		done++;
+	}
+	if (done == 0)
+		return;
+	pool->failure_count -= done;
+	memmove(pool->failures, pool->failures + done,
+		sizeof(ParallelFailure) * pool->failure_count);
+}
+
+/**
+ * parallel_queue_failure - Queues the status of a failed line.
+ * @pool: Pointer to the Parallel structure.
+ * @shell: Pointer to the shell state.
+ * @slot: Pointer to the ParallelSlot structure of the line.
+ *
+ * The queue is kept in line order; without memory the failure is reported
+ * at once instead.
+ */
+static void parallel_queue_failure(Parallel *pool, ShellState *shell,
+				   ParallelSlot *slot)
+{
+	if (pool->failure_count == pool->failure_capacity) {
+		size_t capacity = pool->failure_capacity ?
+					  pool->failure_capacity * 2 :
+					  4;
+		ParallelFailure *failures = realloc(
+			pool->failures, sizeof(ParallelFailure) * capacity);
+
+		if (!failures) {
+			parallel_report(shell, slot->line_number,
+					slot->status);
+			return;
+		}
+		pool->failures = failures;
+		pool->failure_capacity = capacity;
+	}
+
+	size_t i = pool->failure_count++;
+	for (; i > 0 && pool->failures[i - 1].sequence > slot->sequence; i--)
+		pool->failures[i] = pool->failures[i - 1];
+	pool->failures[i].sequence = slot->sequence;
+	pool->failures[i].line_number = slot->line_number;
+	pool->failures[i].status = slot->status;
+}
+
+/**
+ * parallel_release - Frees the slot of a finished line.
+ * @pool: Pointer to the Parallel structure.
+ * @shell: Pointer to the shell state.
+ * @slot: Pointer to the ParallelSlot structure, whose output is written.
+ *
+ * Failures of this and earlier lines are reported as soon as every line
+ * before them is done.
+ */
+static void parallel_release(Parallel *pool, ShellState *shell,
+			     ParallelSlot *slot)
+{
+	slot->pid = 0;
+	slot->length = 0;
+	pool->running--;
+	if (slot->status != 0)
+		parallel_queue_failure(pool, shell, slot);
+	parallel_report_ready(pool, shell);
+}
+
+/**
+ * parallel_find - Finds the running line with a given sequence number.
+ * @pool: Pointer to the Parallel structure.
+ * @sequence: The sequence number.
+ * Return: Pointer to its ParallelSlot structure, or NULL.
+ */
+static ParallelSlot *parallel_find(Parallel *pool, unsigned long sequence)
+{
+	for (int i = 0; i < pool->size; i++) {
+		if (pool->slots[i].pid && pool->slots[i].sequence == sequence)
+			return &pool->slots[i];
+	}
+	return NULL;
+}
+
+/**
+ * parallel_collect - Writes finished output and frees finished slots.
+ * @pool: Pointer to the Parallel structure.
+ * @shell: Pointer to the shell state.
+ *
+ * In keep_order mode the output of the oldest line is written as soon as
+ * it arrives; later lines keep theirs, and their slots, until every line
+ * before them is done.
+ */
+static void parallel_collect(Parallel *pool, ShellState *shell)
+{
+	ParallelSlot *slot;
+
+	if (!pool->keep_order) {
+		for (int i = 0; i < pool->size; i++) {
+			if (pool->slots[i].pid && pool->slots[i].exited)
+				parallel_release(pool, shell, &pool->slots[i]);
+		}
+		return;
+	}
+
+	while ((slot = parallel_find(pool, pool->next_output)) != NULL) {
+		if (slot->length > 0) {
+			output_write(STDOUT_FILENO, slot->buffer, slot->length);
+			output_flush(STDOUT_FILENO);
+			slot->length = 0;
+		}
+		if (!slot->exited || slot->output >= 0)
+			break;
+		parallel_release(pool, shell, slot);
+		pool->next_output++;
+	}
+}
+
+/**
+ * parallel_poll - Waits until a child exits or writes output.
+ * @pool: Pointer to the Parallel structure, with running children.
+ *
+ * Children are watched through pidfds where the kernel has them, and
+ * polled every PARALLEL_POLL_MS milliseconds otherwise.
+ */
+static void parallel_poll(Parallel *pool)
+{
+	int count = 0, timeout = -1;
+
+	for (int i = 0; i < pool->size; i++) {
+		ParallelSlot *slot = &pool->slots[i];
+
+		slot->poll_pid = -1;
+		slot->poll_output = -1;
+		if (!slot->pid)
+			continue;
+		if (!slot->exited && slot->pidfd < 0)
+			timeout = PARALLEL_POLL_MS;
+		if (!slot->exited && slot->pidfd >= 0) {
+			pool->polls[count].fd = slot->pidfd;
+			pool->polls[count].events = POLLIN;
+			slot->poll_pid = count++;
+		}
+		if (slot->output >= 0 && slot->length < PARALLEL_BUFFER_MAX) {
+			pool->polls[count].fd = slot->output;
+			pool->polls[count].events = POLLIN;
+			slot->poll_output = count++;
+		}
+	}
+
+	if ((count == 0 && timeout < 0) ||
+	    poll(pool->polls, count, timeout) < 0)
+		return;
+
+	for (int i = 0; i < pool->size; i++) {
+		ParallelSlot *slot = &pool->slots[i];
+
+		if (slot->poll_output >= 0 &&
+		    pool->polls[slot->poll_output].revents)
+			parallel_read(slot);
+		if (slot->pid && !slot->exited &&
+		    (slot->poll_pid < 0 || pool->polls[slot->poll_pid].revents))
+			parallel_reap(pool, slot);
+	}
+}
+
+/**
+ * parallel_wait - Runs the event loop until slots are free.
+ * @pool: Pointer to the Parallel structure.
+ * @shell: Pointer to the shell state.
+ * @all: true to wait for every line, false for one free slot.
+ */
+static void parallel_wait(Parallel *pool, ShellState *shell, bool all)
+{
+	while (pool->running > 0 && (all || pool->running == pool->size)) {
+		parallel_poll(pool);
+		parallel_collect(pool, shell);
+	}
+}
+
+/**
+ * parallel_start - Starts a line in the pool, waiting for a free slot.
+ * @pool: Pointer to the Parallel structure.
+ * @shell: Pointer to the shell state.
+ * @command: The command of the line; the caller still owns it.
+ *
+ * The line runs in a child, so it must not change the shell; see
+ * execute_is_stateless. $? is left alone until parallel_finish.
+ *
+ * Return: true if the line was started, false after reporting an error.
+ */
+bool parallel_start(Parallel *pool, ShellState *shell, Command *command)
+{
+	int pipefd[2] = { -1, -1 };
+	ParallelSlot *slot = pool->slots;
+	pid_t pid;
+
+	parallel_wait(pool, shell, false);
+	while (slot->pid)
+		slot++;
+
+	if (pool->keep_order) {
+		if (pipe2(pipefd, O_CLOEXEC) < 0) {
+			output_printf(STDERR_FILENO, "%s: %d: pipe: %s\n",
+				      shell->name, shell->line_number,
+				      strerror(errno));
+			return false;
+		}
+		/* the child keeps a blocking write end */
+		fcntl(pipefd[0], F_SETFL, O_NONBLOCK);
+	}
+	pid = execute_spawn(shell, command, pipefd[1]);
+	if (pipefd[1] >= 0)
+		close(pipefd[1]);
+	if (pid < 0) {
+		if (pipefd[0] >= 0)
+			close(pipefd[0]);
+		return false;
+	}
+
+	slot->pid = pid;
+	slot->pidfd = parallel_pidfd(pid);
+	slot->output = pipefd[0];
+	slot->sequence = pool->next_sequence++;
+	slot->line_number = shell->line_number;
+	slot->status = 0;
+	slot->exited = false;
+	slot->length = 0;
+	pool->running++;
+	pool->pending = true;
+	return true;
+}
+
+/**
+ * parallel_finish - Waits for every line of the pool.
+ * @pool: Pointer to the Parallel structure.
+ * @shell: Pointer to the shell state.
+ *
+ * Afterwards $? holds the status of the last line started, as if the
+ * lines had run one after the other, and every line that failed has been
+ * reported with its status.
+ */
+void parallel_finish(Parallel *pool, ShellState *shell)
+{
+	parallel_wait(pool, shell, true);
+	if (pool->pending)
+		shell->last_status = pool->last_status;
+	pool->pending = false;
+}
+
+/**
+ * parallel_free - Frees a pool whose lines have finished.
+ * @pool: Pointer to the Parallel structure, may be NULL.
+ */
+void parallel_free(Parallel *pool)
+{
+	if (!pool)
+		return;
+	for (int i = 0; pool->slots && i < pool->size; i++)
+		free(pool->slots[i].buffer);
+	free(pool->slots);
+	free(pool->polls);
+	free(pool->failures);
+	free(pool);
+}
@@ -0,0 +1,51 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "command.h"
+#include "shell.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+typedef struct ParallelSlot {
+	pid_t pid;
+	int pidfd;
+	int output;
+	int poll_pid;
+	int poll_output;
+	unsigned long sequence;
+	int line_number;
+	int status;
+	bool exited;
+	char *buffer;
+	size_t length;
+	size_t capacity;
+} ParallelSlot;
+
+typedef struct ParallelFailure {
+	unsigned long sequence;
+	int line_number;
+	int status;
+} ParallelFailure;
+
+typedef struct Parallel {
+	ParallelSlot *slots;
+	struct pollfd *polls;
+	int size;
+	int running;
+	bool keep_order;
+	bool pending;
+	unsigned long next_sequence;
+	unsigned long next_output;
+	int last_status;
+	ParallelFailure *failures;
+	size_t failure_count;
+	size_t failure_capacity;
+} Parallel;
+
+Parallel *parallel_new(int size, bool keep_order);
+bool parallel_start(Parallel *pool, ShellState *shell, Command *command);
+void parallel_finish(Parallel *pool, ShellState *shell);
+void parallel_free(Parallel *pool);
+
+#endif
@@ -1,7 +1,19 @@
 #include "parser.h"
+#include "expand.h"
+#include "intern.h"
+#include "output.h"
+#include "pattern.h"
+#include <ctype.h>
+#include <fcntl.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static Command *parse_list(Parser *p);
+static Command *parse_pipeline(Parser *p);
+static Command *parse_command(Parser *p);
 
 /**
  * parser_peek - Returns the current token.
@@ -24,13 +36,13 @@ static Token *parser_previous(Parser *p)
 	return p->prev;
 }
 /**
- * parser_is_eol - Checks if the current token is an end-of-line token.
+ * parser_is_eol - Checks if the parser has reached the end of the input.
  * @p: Pointer to the Parser structure.
- * Return: true if the current token is TOKEN_EOL, false otherwise.
+ * Return: true if the current token is TOKEN_EOF, false otherwise.
  */
 static bool parser_is_eol(Parser *p)
 {
-	return parser_peek(p)->type == TOKEN_EOL;
+	return parser_peek(p)->type == TOKEN_EOF;
 }
 /**
  * parser_advance - Advances the parser to the next token.
@@ -69,6 +81,286 @@ static bool parser_match(Parser *p, int n, ...)
 	va_end(args);
 	return false;
 }
+/**
+ * parser_check_word - Checks if the current token is the given word.
+ * @p: Pointer to the Parser structure.
+ * @word: The text to compare against, such as a reserved word.
+ * Return: true if the current token is a word with that text.
+ */
+static bool parser_check_word(Parser *p, const char *word)
+{
+	return parser_peek(p)->type == TOKEN_WORD &&
+	       strcmp(parser_peek(p)->lexeme, word) == 0;
+}
+/**
+ * parser_match_word - Matches a word token with the given text.
+ * @p: Pointer to the Parser structure.
+ * @word: The text to match, such as a reserved word.
+ * Return: true if the current token matched and was consumed.
+ */
+static bool parser_match_word(Parser *p, const char *word)
+{
+	if (!parser_check_word(p, word))
+		return false;
+	p->prev = parser_advance(p);
+	return true;
+}
+/**
+ * parser_skip_newlines - Skips any newline tokens.
+ * @p: Pointer to the Parser structure.
+ */
+static void parser_skip_newlines(Parser *p)
+{
+	while (parser_match(p, 1, TOKEN_EOL))
+		;
+}
+/**
+ * parser_at_list_end - Checks if the current token ends a command list.
+ * @p: Pointer to the Parser structure.
+ * Return: true at the end of input, at ";;", at ")" or at a reserved word
+ *         closing a list.
+ */
+static bool parser_at_list_end(Parser *p)
+{
+	static const char *const terminators[] = { "then", "else", "elif",
+						   "fi",   "do",   "done",
+						   "}",    "esac" };
+
+	if (parser_is_eol(p) || parser_peek(p)->type == TOKEN_DSEMI ||
+	    parser_peek(p)->type == TOKEN_RPAREN)
+		return true;
+	for (size_t i = 0; i < sizeof(terminators) / sizeof(terminators[0]);
+	     i++) {
+		if (parser_check_word(p, terminators[i]))
+			return true;
+	}
+	return false;
+}
+/**
+ * parser_error - Reports a syntax error at the current token.
+ * @p: Pointer to the Parser structure.
+ * @expected: The reserved word that was expected, or NULL.
+ */
+static void parser_error(Parser *p, const char *expected)
+{
+	Token *token = parser_peek(p);
+
+	p->shell->had_error = true;
+	if (token->type == TOKEN_EOF)
+		output_printf(STDERR_FILENO,
+			      "%s: %d: Syntax error: end of file unexpected",
+			      p->shell->name, p->shell->line_number);
+	else if (token->type == TOKEN_EOL)
+		output_printf(STDERR_FILENO,
+			      "%s: %d: Syntax error: end of line unexpected",
+			      p->shell->name, p->shell->line_number);
+	else
+		output_printf(STDERR_FILENO,
+			      "%s: %d: Syntax error: \"%s\" unexpected",
+			      p->shell->name, p->shell->line_number,
+			      token->lexeme);
+	if (expected)
+		output_printf(STDERR_FILENO, " (expecting \"%s\")", expected);
+	output_putc(STDERR_FILENO, '\n');
+}
+/**
+ * parser_expect_word - Consumes a required reserved word.
+ * @p: Pointer to the Parser structure.
+ * @word: The reserved word expected.
+ * Return: true if the word was consumed, false after reporting an error.
+ */
+static bool parser_expect_word(Parser *p, const char *word)
+{
+	if (parser_match_word(p, word))
+		return true;
+	parser_error(p, word);
+	return false;
+}
+/**
+ * parser_new_command - Allocates a command node.
+ * @p: Pointer to the Parser structure.
+ * @type: The type of the command.
+ * Return: Pointer to the zeroed Command structure, or NULL on failure.
+ */
+static Command *parser_new_command(Parser *p, CommandType type)
+{
+	Command *cmd = calloc(1, sizeof(Command));
+
+	if (!cmd) {
+		p->shell->fatal_error = true;
+		return NULL;
+	}
+	cmd->type = type;
+	cmd->is_background = false;
+	return cmd;
+}
+/**
+ * parser_take_word - Moves the text of the previous token into an array.
+ * @p: Pointer to the Parser structure.
+ * @words: Pointer to the NULL-terminated array, grown as needed.
+ * @count: Pointer to the number of words in the array.
+ * @capacity: Pointer to the allocated size of the array.
+ *
+ * The command tree takes ownership of the string, so a tree outlives the
+ * tokens it was parsed from; function definitions rely on this.
+ *
+ * Return: true on success, false on allocation failure.
+ */
+static bool parser_take_word(Parser *p, char ***words, int *count,
+			     int *capacity)
+{
+	if (*count + 1 >= *capacity) {
+		int new_capacity = *capacity ? *capacity * 2 : 4;
+		char **new_words =
+			realloc(*words, sizeof(char *) * new_capacity);
+		if (!new_words) {
+			p->shell->fatal_error = true;
+			return false;
+		}
+		*words = new_words;
+		*capacity = new_capacity;
+	}
+	(*words)[(*count)++] = parser_previous(p)->lexeme;
+	(*words)[*count] = NULL;
+	parser_previous(p)->lexeme = NULL;
+	return true;
+}
+/**
+ * parser_take_lexeme - Takes ownership of the text of the previous token.
+ * @p: Pointer to the Parser structure.
+ * Return: The string, now owned by the caller.
+ */
+static char *parser_take_lexeme(Parser *p)
+{
+	char *lexeme = parser_previous(p)->lexeme;
+
+	parser_previous(p)->lexeme = NULL;
+	return lexeme;
+}
+/**
+ * parser_at_redirection - Checks if a redirection starts here.
+ * @p: Pointer to the Parser structure.
+ * Return: true at a redirection operator or the descriptor before one.
+ */
+static bool parser_at_redirection(Parser *p)
+{
+	return token_is_redirection(parser_peek(p)->type);
+}
+/**
+ * parser_redirect_fd - Parses the descriptor named by a ">&" target.
+ * @word: The target, with no expansions.
+ * Return: The descriptor, or -1 if @word is not a single digit.
+ */
+static int parser_redirect_fd(const char *word)
+{
+	if (!isdigit((unsigned char)word[0]) || word[1] != '\0')
+		return -1;
+	return word[0] - '0';
+}
+/**
+ * parser_compile_redirection - Fills in a redirection from its operator.
+ * @p: Pointer to the Parser structure.
+ * @op: The operator token.
+ * @redirect: The redirection, with @fd and @word set.
+ *
+ * Open flags and literal descriptors are worked out here, once, so running
+ * the command only has to open or duplicate.
+ *
+ * Return: true on success, false on a bad descriptor.
+ */
+static bool parser_compile_redirection(Parser *p, Token *op,
+				       Redirect *redirect)
+{
+	redirect->type = REDIRECT_FILE;
+	redirect->source = -1;
+	switch (op->type) {
+	case TOKEN_REDIRECT_IN:
+		redirect->flags = O_RDONLY;
+		return true;
+	case TOKEN_REDIRECT_OUT:
+		redirect->flags = O_WRONLY | O_CREAT | O_TRUNC;
+		return true;
+	case TOKEN_REDIRECT_APPEND:
+		redirect->flags = O_WRONLY | O_CREAT | O_APPEND;
+		return true;
+	case TOKEN_REDIRECT_READ_WRITE:
+		redirect->flags = O_RDWR | O_CREAT;
+		return true;
+	default:
+		break;
+	}
+
+	redirect->type = REDIRECT_DUP;
+	if (expand_needed(redirect->word))
+		return true;
+	if (strcmp(redirect->word, "-") == 0)
+		redirect->type = REDIRECT_CLOSE;
+	else
+		redirect->source = parser_redirect_fd(redirect->word);
+	intern_release(redirect->word);
+	redirect->word = NULL;
+	if (redirect->type == REDIRECT_DUP && redirect->source < 0) {
+		p->shell->had_error = true;
+		output_printf(STDERR_FILENO,
+			      "%s: %d: Syntax error: Bad fd number\n",
+			      p->shell->name, p->shell->line_number);
+		return false;
+	}
+	return true;
+}
+/**
+ * parse_redirection - Parses a redirection onto a command's list.
+ * @p: Pointer to the Parser structure, at the redirection.
+ * @simple: Pointer to the SimpleCommand structure receiving it.
+ *
+ * Redirections are kept in the order written, since "2>&1 >file" and
+ * ">file 2>&1" differ.
+ *
+ * Return: true on success, false on failure.
+ */
+static bool parse_redirection(Parser *p, SimpleCommand *simple)
+{
+	Redirect *redirects, *redirect;
+	int fd = -1;
+	Token *op;
+
+	if (parser_match(p, 1, TOKEN_IO_NUMBER))
+		fd = parser_previous(p)->lexeme[0] - '0';
+	op = parser_advance(p);
+	if (fd < 0) {
+		bool input = op->type == TOKEN_REDIRECT_IN ||
+			     op->type == TOKEN_REDIRECT_READ_WRITE ||
+			     op->type == TOKEN_REDIRECT_DUP_IN;
+
+		fd = input ? STDIN_FILENO : STDOUT_FILENO;
+	}
+
+	if (!parser_match(p, 1, TOKEN_WORD)) {
+		p->shell->had_error = true;
+		output_printf(STDERR_FILENO,
+			      "%s: %d: Syntax error: "
+			      "expected filename after '%s'\n",
+			      p->shell->name, p->shell->line_number,
+			      op->lexeme);
+		return false;
+	}
+
+	redirects = realloc(simple->redirects,
+			    sizeof(Redirect) * (simple->redirect_count + 1));
+	if (!redirects) {
+		p->shell->fatal_error = true;
+		return false;
+	}
+	simple->redirects = redirects;
+	redirect = &redirects[simple->redirect_count++];
+	redirect->fd = fd;
+	redirect->word = parser_take_lexeme(p);
+	if (!parser_compile_redirection(p, op, redirect))
+		return false;
+	if (redirect->word && expand_needed(redirect->word))
+		simple->needs_expansion = true;
+	return true;
+}
 /**
  * parse_simple_command - Parses a simple command.
  * @p: Pointer to the Parser structure.
@@ -77,194 +369,540 @@ static bool parser_match(Parser *p, int n, ...)
  */
 static Command *parse_simple_command(Parser *p)
 {
-	SimpleCommand *simple = malloc(sizeof(SimpleCommand));
-	int envc = 0, capacity = 2;
+	Command *cmd = parser_new_command(p, CMD_SIMPLE);
+	int envc = 0, env_capacity = 0, arg_capacity = 0;
+	SimpleCommand *simple;
 
-	if (!simple) {
-		p->shell->fatal_error = true;
+	if (!cmd)
 		return NULL;
+	simple = &cmd->as.command;
+
+	while (parser_match(p, 1, TOKEN_ASSIGNMENT_WORD)) {
+		if (expand_needed(parser_previous(p)->lexeme))
+			simple->needs_expansion = true;
+		if (!parser_take_word(p, &simple->envp, &envc, &env_capacity))
+			goto fail;
+	}
+
+	while (true) {
+		if (parser_match(p, 1, TOKEN_WORD) ||
+		    (simple->argc > 0 &&
+		     parser_match(p, 1, TOKEN_ASSIGNMENT_WORD))) {
+			if (expand_needed(parser_previous(p)->lexeme))
+				simple->needs_expansion = true;
+			if (!parser_take_word(p, &simple->argv, &simple->argc,
+					      &arg_capacity))
+				goto fail;
+
+		} else if (parser_at_redirection(p)) {
+			if (!parse_redirection(p, simple))
+				goto fail;
+		} else {
+			break;
+		}
 	}
 
-	simple->argc = 0;
-	simple->argv = malloc(sizeof(char *) * capacity);
-	simple->envp = malloc(sizeof(char *) * capacity);
-	simple->input_file = NULL;
-	simple->output_file = NULL;
-	simple->append_output = false;
+	if (simple->argc == 0 && envc == 0 && simple->redirect_count == 0) {
+		parser_error(p, NULL);
+		goto fail;
+	}
 
+	/* executors rely on both arrays being present */
+	if (!simple->argv)
+		simple->argv = calloc(1, sizeof(char *));
+	if (!simple->envp)
+		simple->envp = calloc(1, sizeof(char *));
 	if (!simple->argv || !simple->envp) {
 		p->shell->fatal_error = true;
-		free(simple->argv);
-		free(simple->envp);
-		free(simple);
+		goto fail;
+	}
+	return cmd;
+
+fail:
+	command_free(cmd);
+	return NULL;
+}
+/**
+ * parse_compound_list - Parses the non-empty list inside a compound command.
+ * @p: Pointer to the Parser structure.
+ * Return: Pointer to the parsed Command structure, or NULL on failure.
+ */
+static Command *parse_compound_list(Parser *p)
+{
+	Command *list = parse_list(p);
+
+	if (!list && !p->shell->had_error && !p->shell->fatal_error)
+		parser_error(p, NULL);
+	return list;
+}
+/**
+ * parse_if - Parses the rest of an if clause after "if" or "elif".
+ * @p: Pointer to the Parser structure.
+ *
+ * An elif chain is parsed as nested CMD_IF nodes in the else part, with the
+ * innermost one consuming the closing "fi".
+ *
+ * Return: Pointer to the parsed Command structure, or NULL on failure.
+ */
+static Command *parse_if(Parser *p)
+{
+	Command *cmd = parser_new_command(p, CMD_IF);
+	if (!cmd)
 		return NULL;
+
+	cmd->as.if_clause.condition = parse_compound_list(p);
+	if (!cmd->as.if_clause.condition || !parser_expect_word(p, "then"))
+		goto fail;
+	cmd->as.if_clause.then_part = parse_compound_list(p);
+	if (!cmd->as.if_clause.then_part)
+		goto fail;
+
+	if (parser_match_word(p, "elif")) {
+		cmd->as.if_clause.else_part = parse_if(p);
+		if (!cmd->as.if_clause.else_part)
+			goto fail;
+		return cmd;
+	}
+	if (parser_match_word(p, "else")) {
+		cmd->as.if_clause.else_part = parse_compound_list(p);
+		if (!cmd->as.if_clause.else_part)
+			goto fail;
 	}
+	if (!parser_expect_word(p, "fi"))
+		goto fail;
+	return cmd;
 
-	while (parser_match(p, 1, TOKEN_ASSIGNMENT_WORD)) {
-		if (envc + 1 >= capacity) {
-			capacity *= 2;
-			char **new_envp = realloc(simple->envp,
-						  capacity * sizeof(char *));
-			if (!new_envp) {
+fail:
+	command_free(cmd);
+	return NULL;
+}
+/**
+ * parse_do_group - Parses a "do list done" loop body.
+ * @p: Pointer to the Parser structure.
+ * Return: Pointer to the parsed body, or NULL on failure.
+ */
+static Command *parse_do_group(Parser *p)
+{
+	Command *body;
+
+	if (!parser_expect_word(p, "do"))
+		return NULL;
+	body = parse_compound_list(p);
+	if (body && !parser_expect_word(p, "done")) {
+		command_free(body);
+		return NULL;
+	}
+	return body;
+}
+/**
+ * parse_loop - Parses the rest of a while or until loop.
+ * @p: Pointer to the Parser structure.
+ * @type: CMD_WHILE or CMD_UNTIL.
+ * Return: Pointer to the parsed Command structure, or NULL on failure.
+ */
+static Command *parse_loop(Parser *p, CommandType type)
+{
+	Command *cmd = parser_new_command(p, type);
+	if (!cmd)
+		return NULL;
+
+	cmd->as.loop.condition = parse_compound_list(p);
+	if (!cmd->as.loop.condition)
+		goto fail;
+	cmd->as.loop.body = parse_do_group(p);
+	if (!cmd->as.loop.body)
+		goto fail;
+	return cmd;
+
+fail:
+	command_free(cmd);
+	return NULL;
+}
+/**
+ * parse_for - Parses the rest of a for loop after "for".
+ * @p: Pointer to the Parser structure.
+ *
+ * The words are expanded once, when the loop starts. Without "in", the
+ * loop iterates over the positional parameters.
+ *
+ * Return: Pointer to the parsed Command structure, or NULL on failure.
+ */
+static Command *parse_for(Parser *p)
+{
+	Command *cmd = parser_new_command(p, CMD_FOR);
+	int capacity = 0;
+
+	if (!cmd)
+		return NULL;
+
+	if (!parser_match(p, 1, TOKEN_WORD) ||
+	    expand_needed(parser_previous(p)->lexeme)) {
+		parser_error(p, NULL);
+		goto fail;
+	}
+	cmd->as.for_clause.name = parser_take_lexeme(p);
+
+	parser_skip_newlines(p);
+	if (parser_match_word(p, "in")) {
+		cmd->as.for_clause.has_in = true;
+		while (parser_match(p, 2, TOKEN_WORD, TOKEN_ASSIGNMENT_WORD)) {
+			if (!parser_take_word(p, &cmd->as.for_clause.words,
+					      &cmd->as.for_clause.word_count,
+					      &capacity))
+				goto fail;
+		}
+		if (!parser_match(p, 2, TOKEN_SEMICOLON, TOKEN_EOL)) {
+			parser_error(p, "do");
+			goto fail;
+		}
+	} else {
+		parser_match(p, 1, TOKEN_SEMICOLON);
+	}
+
+	parser_skip_newlines(p);
+	cmd->as.for_clause.body = parse_do_group(p);
+	if (!cmd->as.for_clause.body)
+		goto fail;
+	return cmd;
+
+fail:
+	command_free(cmd);
+	return NULL;
+}
+/**
+ * parse_case_arm - Parses one "pattern | pattern) list ;;" arm of a case.
+ * @p: Pointer to the Parser structure.
+ * @arm: The zeroed CaseArm to fill in.
+ *
+ * The list may be empty, and the ";;" may be left out before "esac".
+ *
+ * Return: true on success, false on failure.
+ */
+static bool parse_case_arm(Parser *p, CaseArm *arm)
+{
+	int capacity = 0;
+
+	parser_match(p, 1, TOKEN_LPAREN);
+	do {
+		if (!parser_match(p, 2, TOKEN_WORD, TOKEN_ASSIGNMENT_WORD)) {
+			parser_error(p, NULL);
+			return false;
+		}
+		if (!parser_take_word(p, &arm->patterns, &arm->pattern_count,
+				      &capacity))
+			return false;
+	} while (parser_match(p, 1, TOKEN_PIPE));
+
+	if (!parser_match(p, 1, TOKEN_RPAREN)) {
+		parser_error(p, ")");
+		return false;
+	}
+	arm->body = parse_list(p);
+	if (p->shell->had_error || p->shell->fatal_error)
+		return false;
+	if (!parser_match(p, 1, TOKEN_DSEMI) && !parser_check_word(p, "esac")) {
+		parser_error(p, ";;");
+		return false;
+	}
+	parser_skip_newlines(p);
+	return true;
+}
+
+/**
+ * parse_case - Parses the rest of a case command after "case".
+ * @p: Pointer to the Parser structure.
+ *
+ * The patterns of all arms are compiled here into one PatternSet, so that
+ * running the command costs one hash lookup plus a single pass of the
+ * combined glob automaton over the word, instead of one glob match per
+ * arm; see pattern_set_match. Only patterns that need expanding are still
+ * matched one by one, and only those before the winning arm.
+ *
+ * Return: Pointer to the parsed Command structure, or NULL on failure.
+ */
+static Command *parse_case(Parser *p)
+{
+	Command *cmd = parser_new_command(p, CMD_CASE);
+	int capacity = 0;
+
+	if (!cmd)
+		return NULL;
+
+	if (!parser_match(p, 2, TOKEN_WORD, TOKEN_ASSIGNMENT_WORD)) {
+		parser_error(p, NULL);
+		goto fail;
+	}
+	cmd->as.case_clause.word = parser_take_lexeme(p);
+	parser_skip_newlines(p);
+	if (!parser_expect_word(p, "in"))
+		goto fail;
+	parser_skip_newlines(p);
+
+	cmd->as.case_clause.patterns = pattern_set_new();
+	if (!cmd->as.case_clause.patterns) {
+		p->shell->fatal_error = true;
+		goto fail;
+	}
+
+	while (!parser_match_word(p, "esac")) {
+		int index = cmd->as.case_clause.arm_count;
+
+		if (index == capacity) {
+			int new_capacity = capacity ? capacity * 2 : 4;
+			CaseArm *arms = realloc(cmd->as.case_clause.arms,
+						sizeof(CaseArm) * new_capacity);
+			if (!arms) {
 				p->shell->fatal_error = true;
-				free(simple->envp);
-				free(simple->argv);
-				free(simple);
-				return NULL;
+				goto fail;
 			}
-			simple->envp = new_envp;
+			cmd->as.case_clause.arms = arms;
+			capacity = new_capacity;
 		}
-		simple->envp[envc++] = parser_previous(p)->lexeme;
-	}
-	simple->envp[envc] = NULL;
 
-	capacity = 2;
-	if (parser_match(p, 1, TOKEN_WORD)) {
-		if (simple->argc + 1 >= capacity) {
-			capacity *= 2;
-			char **new_argv = realloc(simple->argv,
-						  sizeof(char *) * capacity);
-			if (!new_argv) {
+		CaseArm *arm = &cmd->as.case_clause.arms[index];
+		memset(arm, 0, sizeof(*arm));
+		cmd->as.case_clause.arm_count++;
+		if (!parse_case_arm(p, arm))
+			goto fail;
+		for (int i = 0; i < arm->pattern_count; i++) {
+			if (!pattern_set_add(cmd->as.case_clause.patterns,
+					     arm->patterns[i], index)) {
 				p->shell->fatal_error = true;
-				free(simple->argv);
-				free(simple->envp);
-				free(simple);
-				return NULL;
+				goto fail;
 			}
-			simple->argv = new_argv;
 		}
-		simple->argv[simple->argc++] = parser_previous(p)->lexeme;
-		simple->argv[simple->argc] = NULL;
-	} else if (parser_is_eol(p)) {
-		free(simple->argv);
-		free(simple->envp);
-		free(simple);
+	}
+	return cmd;
+
+fail:
+	command_free(cmd);
+	return NULL;
+}
+/**
+ * parse_group - Parses the rest of a "{ list; }" group.
+ * @p: Pointer to the Parser structure.
+ * Return: Pointer to the parsed Command structure, or NULL on failure.
+ */
+static Command *parse_group(Parser *p)
+{
+	Command *cmd = parser_new_command(p, CMD_GROUP);
+	if (!cmd)
 		return NULL;
-	} else {
-		p->shell->had_error = true;
-		printf("%s: %d: Syntax error: \"%s\" unexpected\n",
-		       p->shell->name, p->shell->line_number,
-		       (parser_previous(p) ? parser_previous(p) :
-					     parser_peek(p))
-			       ->lexeme);
-		free(simple->argv);
-		free(simple->envp);
-		free(simple);
+
+	cmd->as.group.body = parse_compound_list(p);
+	if (!cmd->as.group.body || !parser_expect_word(p, "}")) {
+		command_free(cmd);
 		return NULL;
 	}
+	return cmd;
+}
+/**
+ * parse_subshell - Parses the rest of a "( list )" subshell.
+ * @p: Pointer to the Parser structure.
+ * Return: Pointer to the parsed Command structure, or NULL on failure.
+ */
+static Command *parse_subshell(Parser *p)
+{
+	Command *cmd = parser_new_command(p, CMD_SUBSHELL);
+	if (!cmd)
+		return NULL;
 
-	while (true) {
-		if (parser_match(p, 2, TOKEN_WORD, TOKEN_ASSIGNMENT_WORD)) {
-			if (simple->argc + 1 >= capacity) {
-				capacity *= 2;
-				char **new_argv =
-					realloc(simple->argv,
-						sizeof(char *) * capacity);
-				if (!new_argv) {
-					p->shell->fatal_error = true;
-					free(simple->argv);
-					free(simple->envp);
-					free(simple);
-					return NULL;
-				}
-				simple->argv = new_argv;
-			}
-			simple->argv[simple->argc++] =
-				parser_previous(p)->lexeme;
-			simple->argv[simple->argc] = NULL;
-
-		} else if (parser_match(p, 3, TOKEN_REDIRECT_IN,
-					TOKEN_REDIRECT_OUT,
-					TOKEN_REDIRECT_APPEND)) {
-			Token *op = parser_previous(p);
-
-			if (!parser_match(p, 1, TOKEN_WORD)) {
-				fprintf(stderr,
-					"%s: %d: Syntax error: "
-					"expected filename after '%s'\n",
-					p->shell->name, p->shell->line_number,
-					op->lexeme);
-				free(simple->argv);
-				free(simple->envp);
-				free(simple);
-				return NULL;
-			}
+	cmd->as.group.body = parse_compound_list(p);
+	if (!cmd->as.group.body)
+		goto fail;
+	if (!parser_match(p, 1, TOKEN_RPAREN)) {
+		parser_error(p, ")");
+		goto fail;
+	}
+	return cmd;
 
-			Token *filename = parser_previous(p);
-
-			switch (op->type) {
-			case TOKEN_REDIRECT_IN:
-				simple->input_file = filename->lexeme;
-				break;
-			case TOKEN_REDIRECT_OUT:
-				simple->output_file = filename->lexeme;
-				simple->append_output = false;
-				break;
-			case TOKEN_REDIRECT_APPEND:
-				simple->output_file = filename->lexeme;
-				simple->append_output = true;
-				break;
-			default:
-				break;
+fail:
+	command_free(cmd);
+	return NULL;
+}
+/**
+ * parse_compound_redirections - Parses redirections after a compound command.
+ * @p: Pointer to the Parser structure.
+ * @cmd: The compound command, or NULL if it failed to parse.
+ *
+ * The redirections are kept as a simple command with no words, so they
+ * are expanded and applied once for the whole compound command.
+ *
+ * Return: @cmd, or NULL on failure.
+ */
+static Command *parse_compound_redirections(Parser *p, Command *cmd)
+{
+	if (!cmd)
+		return NULL;
+	while (parser_at_redirection(p)) {
+		if (!cmd->redirect) {
+			cmd->redirect = calloc(1, sizeof(SimpleCommand));
+			if (cmd->redirect)
+				cmd->redirect->envp = calloc(1, sizeof(char *));
+			if (!cmd->redirect || !cmd->redirect->envp) {
+				p->shell->fatal_error = true;
+				command_free(cmd);
+				return NULL;
 			}
-		} else {
-			break;
+		}
+		if (!parse_redirection(p, cmd->redirect)) {
+			command_free(cmd);
+			return NULL;
 		}
 	}
-
-	Command *cmd = malloc(sizeof(Command));
-	if (!cmd) {
-		p->shell->fatal_error = true;
-		free(simple->argv);
-		free(simple->envp);
-		free(simple);
+	return cmd;
+}
+/**
+ * parser_at_compound - Checks if a compound command starts here.
+ * @p: Pointer to the Parser structure.
+ * Return: true if the current token opens a compound command.
+ */
+static bool parser_at_compound(Parser *p)
+{
+	return parser_check_word(p, "if") || parser_check_word(p, "while") ||
+	       parser_check_word(p, "until") || parser_check_word(p, "for") ||
+	       parser_check_word(p, "case") || parser_check_word(p, "{") ||
+	       parser_peek(p)->type == TOKEN_LPAREN;
+}
+/**
+ * parser_is_name - Checks if a word is a valid name for a function.
+ * @word: The word to check.
+ * Return: true for a letter or underscore followed by alphanumerics.
+ */
+static bool parser_is_name(const char *word)
+{
+	if (!isalpha((unsigned char)*word) && *word != '_')
+		return false;
+	while (*++word) {
+		if (!isalnum((unsigned char)*word) && *word != '_')
+			return false;
+	}
+	return true;
+}
+/**
+ * parse_function - Parses a "name() compound-command" definition.
+ * @p: Pointer to the Parser structure.
+ *
+ * The body is parsed once, here; running the definition only stores the
+ * tree in the function table.
+ *
+ * Return: Pointer to the parsed Command structure, or NULL on failure.
+ */
+static Command *parse_function(Parser *p)
+{
+	Command *cmd = parser_new_command(p, CMD_FUNCTION);
+	if (!cmd)
 		return NULL;
+
+	cmd->as.function.refs = 1;
+	parser_match(p, 1, TOKEN_WORD);
+	if (!parser_is_name(parser_previous(p)->lexeme)) {
+		p->shell->had_error = true;
+		output_printf(STDERR_FILENO,
+			      "%s: %d: Syntax error: Bad function name\n",
+			      p->shell->name, p->shell->line_number);
+		goto fail;
 	}
+	cmd->as.function.name = parser_take_lexeme(p);
 
-	cmd->type = CMD_SIMPLE;
-	cmd->as.command = *simple;
-	cmd->is_background = false;
-	free(simple);
+	parser_match(p, 1, TOKEN_LPAREN);
+	if (!parser_match(p, 1, TOKEN_RPAREN)) {
+		parser_error(p, ")");
+		goto fail;
+	}
+	parser_skip_newlines(p);
+	if (!parser_at_compound(p)) {
+		parser_error(p, NULL);
+		goto fail;
+	}
+	cmd->as.function.body = parse_command(p);
+	if (!cmd->as.function.body)
+		goto fail;
 	return cmd;
+
+fail:
+	command_free(cmd);
+	return NULL;
+}
+/**
+ * parse_command - Parses a simple or compound command.
+ * @p: Pointer to the Parser structure.
+ *
+ * Reserved words are only recognised here, where a command name is
+ * expected.
+ *
+ * Return: Pointer to the parsed Command structure, or NULL on failure.
+ */
+static Command *parse_command(Parser *p)
+{
+	if (parser_match_word(p, "if"))
+		return parse_compound_redirections(p, parse_if(p));
+	if (parser_match_word(p, "while"))
+		return parse_compound_redirections(p,
+						   parse_loop(p, CMD_WHILE));
+	if (parser_match_word(p, "until"))
+		return parse_compound_redirections(p,
+						   parse_loop(p, CMD_UNTIL));
+	if (parser_match_word(p, "for"))
+		return parse_compound_redirections(p, parse_for(p));
+	if (parser_match_word(p, "case"))
+		return parse_compound_redirections(p, parse_case(p));
+	if (parser_match_word(p, "{"))
+		return parse_compound_redirections(p, parse_group(p));
+	if (parser_match(p, 1, TOKEN_LPAREN))
+		return parse_compound_redirections(p, parse_subshell(p));
+	if (parser_peek(p)->type == TOKEN_WORD &&
+	    parser_peek(p)->next->type == TOKEN_LPAREN)
+		return parse_function(p);
+	return parse_simple_command(p);
 }
 /**
  * parse_pipeline - Parses a pipeline of commands connected by pipe operators.
  * @p: Pointer to the Parser structure.
  *
+ * A leading "time" reserved word wraps the whole pipeline in a CMD_TIME
+ * node, so that every stage is measured as one unit.
+ *
  * Return: Pointer to the parsed Command structure, or NULL on failure.
  */
 static Command *parse_pipeline(Parser *p)
 {
-	Command *cmd = parse_simple_command(p);
-	if (cmd)
-		cmd->is_background = false;
-	else if (p->shell->had_error)
-		return NULL;
+	if (parser_match_word(p, "time")) {
+		bool posix_format = parser_match_word(p, "-p");
+		Command *body = parse_pipeline(p);
+		if (p->shell->had_error || p->shell->fatal_error)
+			return NULL;
 
-	while (parser_match(p, 1, TOKEN_PIPE)) {
-		if (parser_is_eol(p)) {
-			p->shell->had_error = true;
-			printf("%s: %d: Syntax error: end of line unexpected\n",
-			       p->shell->name, p->shell->line_number);
-			command_free(cmd);
+		Command *timed = parser_new_command(p, CMD_TIME);
+		if (!timed) {
+			command_free(body);
 			return NULL;
 		}
-		Command *right = parse_simple_command(p);
+		timed->as.timed.body = body;
+		timed->as.timed.posix_format = posix_format;
+		return timed;
+	}
+
+	Command *cmd = parse_command(p);
+	if (!cmd)
+		return NULL;
+
+	while (parser_match(p, 1, TOKEN_PIPE)) {
+		parser_skip_newlines(p);
+		Command *right = parse_command(p);
 		if (!right) {
 			command_free(cmd);
 			return NULL;
 		}
-		Command *parent = malloc(sizeof(Command));
+		Command *parent = parser_new_command(p, CMD_PIPE);
 		if (!parent) {
 			command_free(cmd);
 			command_free(right);
 			return NULL;
 		}
 		parent->as.binary.left = cmd;
-		parent->type = CMD_PIPE;
 		parent->as.binary.right = right;
 		cmd = parent;
-		cmd->is_background = false;
 	}
 	return cmd;
 }
@@ -278,92 +916,96 @@ static Command *parse_pipeline(Parser *p)
 static Command *parse_logical_list(Parser *p)
 {
 	Command *cmd = parse_pipeline(p);
-	if (cmd)
-		cmd->is_background = false;
-	else if (p->shell->had_error)
+	if (!cmd)
 		return NULL;
 
 	while (parser_match(p, 2, TOKEN_AND, TOKEN_OR)) {
-		if (parser_is_eol(p)) {
-			p->shell->had_error = true;
-			printf("%s: %d: Syntax error: end of line unexpected\n",
-			       p->shell->name, p->shell->line_number);
-			command_free(cmd);
-			return NULL;
-		}
 		CommandType parent_type =
 			parser_previous(p)->type == TOKEN_AND ? CMD_AND :
 								CMD_OR;
+		parser_skip_newlines(p);
 		Command *right = parse_pipeline(p);
 		if (!right) {
 			command_free(cmd);
 			return NULL;
 		}
-		Command *parent = malloc(sizeof(Command));
+		Command *parent = parser_new_command(p, parent_type);
 		if (!parent) {
 			command_free(cmd);
 			command_free(right);
 			return NULL;
 		}
-		parent->type = parent_type;
 		parent->as.binary.left = cmd;
 		parent->as.binary.right = right;
 		cmd = parent;
-		cmd->is_background = false;
 	}
 	return cmd;
 }
 /**
- * parse_command - Parses a command, handling background execution.
+ * parse_list - Parses commands separated by ';', '&' or newlines.
  * @p: Pointer to the Parser structure.
  *
- * Return: Pointer to the parsed Command structure, or NULL on failure.
+ * Parsing stops at the end of input or at a reserved word that closes the
+ * enclosing compound command. The commands are chained left to right in
+ * CMD_SEPARATOR nodes; a command followed by '&' is marked as background.
+ *
+ * Return: Pointer to the parsed Command structure, or NULL if the list is
+ *         empty or on failure.
  */
-static Command *parse_command(Parser *p)
+static Command *parse_list(Parser *p)
 {
-	Command *cmd = parse_logical_list(p);
-	if (p->shell->had_error) {
-		command_free(cmd);
-		return NULL;
-	}
+	Command *list = NULL;
 
-	while (parser_match(p, 1, TOKEN_BACKGROUND)) {
-		cmd->is_background = true;
-		if (p->shell->had_error) {
-			command_free(cmd);
+	parser_skip_newlines(p);
+	while (!parser_at_list_end(p)) {
+		Command *item = parse_logical_list(p);
+		if (!item) {
+			command_free(list);
 			return NULL;
 		}
-		if (parser_is_eol(p))
-			return cmd;
 
-		Command *right = parse_logical_list(p);
-		if (p->shell->had_error || !right) {
-			command_free(cmd);
-			command_free(right);
+		if (parser_match(p, 1, TOKEN_BACKGROUND)) {
+			item->is_background = true;
+		} else if (!parser_match(p, 2, TOKEN_SEMICOLON, TOKEN_EOL) &&
+			   !parser_at_list_end(p)) {
+			parser_error(p, NULL);
+			command_free(item);
+			command_free(list);
 			return NULL;
 		}
-		Command *parent = malloc(sizeof(Command));
-		if (p->shell->had_error || !parent) {
-			command_free(parent);
-			command_free(cmd);
-			command_free(right);
+		parser_skip_newlines(p);
+
+		if (!list) {
+			list = item;
+			continue;
+		}
+		Command *parent = parser_new_command(p, CMD_SEPARATOR);
+		if (!parent) {
+			command_free(item);
+			command_free(list);
 			return NULL;
 		}
-		parent->as.binary.left = cmd;
-		parent->type = CMD_SEPARATOR;
-		parent->as.binary.right = right;
-		cmd = parent;
+		parent->as.binary.left = list;
+		parent->as.binary.right = item;
+		list = parent;
 	}
-	return cmd;
+	return list;
 }
 /**
  * parse - Parses a list of tokens into a command structure.
  * @shell: Pointer to the shell state.
- * @tokens: Pointer to the head of the token list.
+ * @tokens: Pointer to the head of the token list, ending in TOKEN_EOF.
  * Return: Pointer to the parsed Command structure, or NULL on failure.
  */
 Command *parse(ShellState *shell, Token *tokens)
 {
 	Parser p = { .current = tokens, .prev = NULL, .shell = shell };
-	return parse_command(&p);
+	Command *cmd = parse_list(&p);
+
+	if (!shell->had_error && !parser_is_eol(&p)) {
+		parser_error(&p, NULL);
+		command_free(cmd);
+		return NULL;
+	}
+	return cmd;
 }
@@ -0,0 +1,667 @@
+#include "pattern.h"
+#include "expand.h"
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct PatternClass {
+	const char *name;
+	int (*test)(int c);
+} PatternClass;
+
+static const PatternClass pattern_classes[] = {
+	{ "alnum", isalnum }, { "alpha", isalpha }, { "blank", isblank },
+	{ "cntrl", iscntrl }, { "digit", isdigit }, { "graph", isgraph },
+	{ "lower", islower }, { "print", isprint }, { "punct", ispunct },
+	{ "space", isspace }, { "upper", isupper }, { "xdigit", isxdigit },
+};
+
+/**
+ * pattern_set_bit - Adds a character to a bracket expression.
+ * @set: The 256-bit character set.
+ * @c: The character.
+ */
+static void pattern_set_bit(unsigned char *set, unsigned char c)
+{
+	set[c / 8] |= 1u << (c % 8);
+}
+
+/**
+ * pattern_has_bit - Checks whether a bracket expression holds a character.
+ * @set: The 256-bit character set.
+ * @c: The character.
+ * Return: true if @c is in the set.
+ */
+static bool pattern_has_bit(const unsigned char *set, unsigned char c)
+{
+	return set[c / 8] & (1u << (c % 8));
+}
+
+/**
+ * pattern_compile_class - Compiles a "[...]" bracket expression.
+ * @glob: Pointer to the text following the '['.
+ * @op: The PATTERN_CLASS operation to fill in.
+ *
+ * Ranges, "!" or "^" negation, backslash escapes and "[:name:]" classes
+ * are supported.
+ *
+ * Return: Pointer past the closing ']', or NULL if there is none, in which
+ *         case the '[' is an ordinary character.
+ */
+static const char *pattern_compile_class(const char *glob, PatternOp *op)
+{
+	const char *p = glob;
+	bool negate = false;
+
+	memset(op->set, 0, sizeof(op->set));
+	op->opcode = PATTERN_CLASS;
+	if (*p == '!' || *p == '^') {
+		negate = true;
+		p++;
+	}
+
+	for (bool first = true; *p && (first || *p != ']'); first = false) {
+		if (p[0] == '[' && p[1] == ':') {
+			const char *end = strstr(p + 2, ":]");
+			size_t i = 0;
+			size_t count = sizeof(pattern_classes) /
+				       sizeof(pattern_classes[0]);
+
+			for (; end && i < count; i++) {
+				if (strncmp(p + 2, pattern_classes[i].name,
+					    end - p - 2) == 0 &&
+				    !pattern_classes[i].name[end - p - 2])
+					break;
+			}
+			if (end && i < count) {
+				for (int c = 1; c < 256; c++) {
+					if (pattern_classes[i].test(c))
+						pattern_set_bit(op->set, c);
+				}
+				p = end + 2;
+				continue;
+			}
+		}
+
+		if (*p == '\\' && p[1])
+			p++;
+		unsigned char low = *p++;
+		unsigned char high = low;
+		if (p[0] == '-' && p[1] && p[1] != ']') {
+			p++;
+			if (*p == '\\' && p[1])
+				p++;
+			high = *p++;
+		}
+		for (unsigned int c = low; c <= high; c++)
+			pattern_set_bit(op->set, c);
+	}
+	if (*p != ']')
+		return NULL;
+
+	if (negate) {
+		for (size_t i = 0; i < sizeof(op->set); i++)
+			op->set[i] = ~op->set[i];
+	}
+	return p + 1;
+}
+
+/**
+ * pattern_compile - Compiles a glob pattern into a sequence of operations.
+ * @glob: The pattern; a backslash makes the next character literal.
+ *
+ * Runs of ordinary characters become one PATTERN_LITERAL operation that is
+ * compared with memcmp, and consecutive '*' collapse into one PATTERN_STAR.
+ *
+ * Return: Pointer to the compiled Pattern, or NULL on allocation failure.
+ */
+Pattern *pattern_compile(const char *glob)
+{
+	size_t length = strlen(glob);
+	Pattern *pattern = calloc(1, sizeof(Pattern));
+
+	if (!pattern)
+		return NULL;
+	/* unescaped text is never longer than the pattern, nor are the ops */
+	pattern->text = malloc(length + 1);
+	pattern->ops = malloc(sizeof(PatternOp) * (length + 1));
+	if (!pattern->text || !pattern->ops) {
+		pattern_free(pattern);
+		return NULL;
+	}
+
+	char *text = pattern->text;
+	const char *p = glob;
+	while (*p) {
+		PatternOp *op = &pattern->ops[pattern->count];
+
+		if (*p == '*') {
+			while (*p == '*')
+				p++;
+			op->opcode = PATTERN_STAR;
+			pattern->has_star = true;
+			pattern->count++;
+			continue;
+		}
+		if (*p == '?') {
+			p++;
+			op->opcode = PATTERN_ANY;
+			pattern->min_length++;
+			pattern->count++;
+			continue;
+		}
+		if (*p == '[') {
+			const char *end = pattern_compile_class(p + 1, op);
+			if (end) {
+				p = end;
+				pattern->min_length++;
+				pattern->count++;
+				continue;
+			}
+		}
+
+		if (*p == '\\' && p[1])
+			p++;
+		/* extend the previous literal if there is one */
+		if (pattern->count == 0 ||
+		    op[-1].opcode != PATTERN_LITERAL) {
+			op->opcode = PATTERN_LITERAL;
+			op->text = text;
+			op->length = 0;
+			pattern->count++;
+		} else {
+			op--;
+		}
+		*text++ = *p++;
+		op->length++;
+		pattern->min_length++;
+	}
+	return pattern;
+}
+
+/**
+ * pattern_match - Matches a string against a compiled pattern.
+ * @pattern: The compiled Pattern.
+ * @subject: The string.
+ * @length: Length of the string.
+ *
+ * On a mismatch only the most recent '*' is retried one character further
+ * on, which is enough because every other operation has a fixed width.
+ *
+ * Return: true if the whole string matches.
+ */
+bool pattern_match(const Pattern *pattern, const char *subject,
+		   size_t length)
+{
+	size_t op = 0, pos = 0;
+	size_t star_op = SIZE_MAX, star_pos = 0;
+
+	if (length < pattern->min_length ||
+	    (!pattern->has_star && length != pattern->min_length))
+		return false;
+
+	for (;;) {
+		if (op < pattern->count) {
+			const PatternOp *o = &pattern->ops[op];
+
+			switch (o->opcode) {
+			case PATTERN_STAR:
+				star_op = ++op;
+				star_pos = pos;
+				continue;
+			case PATTERN_LITERAL:
+				if (length - pos >= o->length &&
+				    memcmp(subject + pos, o->text, o->length) ==
+					    0) {
+					pos += o->length;
+					op++;
+					continue;
+				}
+				break;
+			case PATTERN_ANY:
+				if (pos < length) {
+					pos++;
+					op++;
+					continue;
+				}
+				break;
+			case PATTERN_CLASS:
+				if (pos < length &&
+				    pattern_has_bit(o->set, subject[pos])) {
+					pos++;
+					op++;
+					continue;
+				}
+				break;
+			}
+		} else if (pos == length) {
+			return true;
+		}
+
+		if (star_op == SIZE_MAX || star_pos >= length)
+			return false;
+		op = star_op;
+		pos = ++star_pos;
+	}
+}
+
+/**
+ * pattern_free - Frees a compiled pattern.
+ * @pattern: Pointer to the Pattern, may be NULL.
+ */
+void pattern_free(Pattern *pattern)
+{
+	if (!pattern)
+		return;
+	free(pattern->ops);
+	free(pattern->text);
+	free(pattern);
+}
+
+/**
+ * pattern_hash - Computes the hash of a literal pattern.
+ * @text: The literal text.
+ * @length: Length of the text.
+ * Return: The hash value.
+ */
+static size_t pattern_hash(const char *text, size_t length)
+{
+	unsigned int hash = 2166136261u;
+
+	for (size_t i = 0; i < length; i++)
+		hash = (hash ^ (unsigned char)text[i]) * 16777619u;
+	return hash;
+}
+
+/**
+ * pattern_is_literal - Checks whether a pattern only matches itself.
+ * @word: The pattern.
+ * Return: true if it has no unescaped '*', '?' or '['.
+ */
+static bool pattern_is_literal(const char *word)
+{
+	for (; *word; word++) {
+		if (*word == '*' || *word == '?' || *word == '[')
+			return false;
+		if (*word == '\\' && word[1])
+			word++;
+	}
+	return true;
+}
+
+/**
+ * pattern_set_new - Creates an empty set of case patterns.
+ * Return: Pointer to the PatternSet, or NULL on allocation failure.
+ */
+PatternSet *pattern_set_new(void)
+{
+	return calloc(1, sizeof(PatternSet));
+}
+
+/**
+ * pattern_set_grow - Doubles the number of literal hash buckets.
+ * @set: Pointer to the PatternSet.
+ * Return: true on success, false on allocation failure.
+ */
+static bool pattern_set_grow(PatternSet *set)
+{
+	size_t count = set->bucket_count ? set->bucket_count * 2 :
+					   PATTERN_BUCKETS_MIN;
+	PatternLiteral **buckets = calloc(count, sizeof(PatternLiteral *));
+
+	if (!buckets)
+		return false;
+	for (size_t i = 0; i < set->bucket_count; i++) {
+		PatternLiteral *lit = set->buckets[i];
+		while (lit) {
+			PatternLiteral *next = lit->next;
+			size_t bucket = pattern_hash(lit->text,
+						     strlen(lit->text)) &
+					(count - 1);
+			lit->next = buckets[bucket];
+			buckets[bucket] = lit;
+			lit = next;
+		}
+	}
+	free(set->buckets);
+	set->buckets = buckets;
+	set->bucket_count = count;
+	return true;
+}
+
+/**
+ * pattern_set_add_literal - Adds a pattern without glob characters.
+ * @set: Pointer to the PatternSet.
+ * @word: The pattern, with backslash escapes.
+ * @arm: Index of the case arm.
+ * Return: true on success, false on allocation failure.
+ */
+static bool pattern_set_add_literal(PatternSet *set, const char *word,
+				    int arm)
+{
+	char *text = malloc(strlen(word) + 1);
+	char *out = text;
+
+	if (!text)
+		return false;
+	for (; *word; word++) {
+		if (*word == '\\' && word[1])
+			word++;
+		*out++ = *word;
+	}
+	*out = '\0';
+
+	if (set->literal_count >= set->bucket_count &&
+	    !pattern_set_grow(set)) {
+		free(text);
+		return false;
+	}
+
+	size_t bucket = pattern_hash(text, out - text) &
+			(set->bucket_count - 1);
+	for (PatternLiteral *lit = set->buckets[bucket]; lit; lit = lit->next) {
+		/* an earlier arm already matches this word */
+		if (strcmp(lit->text, text) == 0) {
+			free(text);
+			return true;
+		}
+	}
+
+	PatternLiteral *lit = malloc(sizeof(PatternLiteral));
+	if (!lit) {
+		free(text);
+		return false;
+	}
+	lit->text = text;
+	lit->arm = arm;
+	lit->next = set->buckets[bucket];
+	set->buckets[bucket] = lit;
+	set->literal_count++;
+	return true;
+}
+
+/**
+ * pattern_set_add_states - Adds a compiled glob to the combined automaton.
+ * @set: Pointer to the PatternSet.
+ * @entry: The entry of the glob, whose pattern is compiled.
+ *
+ * Each pattern becomes a chain of states, one per character it consumes
+ * and a final one that accepts its arm. A '*' becomes a flag on the state
+ * after it, which then also consumes any character and stays put.
+ *
+ * Return: true on success, false on allocation failure.
+ */
+static bool pattern_set_add_states(PatternSet *set, PatternEntry *entry)
+{
+	const Pattern *pattern = entry->pattern;
+	size_t needed = set->state_count + pattern->min_length + 1;
+
+	if (needed > set->state_capacity) {
+		size_t capacity = set->state_capacity * 2 > needed ?
+					  set->state_capacity * 2 :
+					  needed;
+		PatternState *states =
+			realloc(set->states, sizeof(PatternState) * capacity);
+		size_t *active, *next;
+
+		if (!states)
+			return false;
+		set->states = states;
+		active = realloc(set->active, sizeof(size_t) * capacity);
+		if (!active)
+			return false;
+		set->active = active;
+		next = realloc(set->next, sizeof(size_t) * capacity);
+		if (!next)
+			return false;
+		set->next = next;
+		set->state_capacity = capacity;
+	}
+
+	PatternState *state = &set->states[set->state_count];
+	bool star = false;
+
+	entry->start = set->state_count;
+	for (size_t i = 0; i < pattern->count; i++) {
+		const PatternOp *op = &pattern->ops[i];
+		size_t width = op->opcode == PATTERN_LITERAL ? op->length : 1;
+
+		if (op->opcode == PATTERN_STAR) {
+			star = true;
+			continue;
+		}
+		for (size_t j = 0; j < width; j++, state++) {
+			state->opcode = op->opcode;
+			state->star = star;
+			state->c = 0;
+			state->set = NULL;
+			state->arm = -1;
+			if (op->opcode == PATTERN_LITERAL)
+				state->c = op->text[j];
+			else if (op->opcode == PATTERN_CLASS)
+				state->set = op->set;
+			star = false;
+		}
+	}
+	state->opcode = PATTERN_ANY;
+	state->star = star;
+	state->set = NULL;
+	state->arm = entry->arm;
+	set->state_count = needed;
+	return true;
+}
+
+/**
+ * pattern_set_add - Adds one pattern of a case arm to the set.
+ * @set: Pointer to the PatternSet.
+ * @word: The pattern word, owned by the caller and kept until the set is
+ *        freed.
+ * @arm: Index of the case arm; arms must be added in order.
+ *
+ * Literal patterns go into a hash table, glob patterns are compiled now
+ * into one automaton shared by all arms, and patterns that need expansion
+ * are kept to be expanded at match time.
+ *
+ * Return: true on success, false on allocation failure.
+ */
+bool pattern_set_add(PatternSet *set, const char *word, int arm)
+{
+	bool dynamic = expand_needed(word);
+
+	if (!dynamic && pattern_is_literal(word))
+		return pattern_set_add_literal(set, word, arm);
+
+	if (set->entry_count == set->entry_capacity) {
+		size_t capacity = set->entry_capacity ?
+					  set->entry_capacity * 2 :
+					  4;
+		PatternEntry *entries =
+			realloc(set->entries, sizeof(PatternEntry) * capacity);
+		if (!entries)
+			return false;
+		set->entries = entries;
+		set->entry_capacity = capacity;
+	}
+
+	PatternEntry *entry = &set->entries[set->entry_count];
+	entry->arm = arm;
+	entry->word = word;
+	entry->pattern = NULL;
+	set->entry_count++;
+	if (!dynamic) {
+		entry->pattern = pattern_compile(word);
+		if (!entry->pattern || !pattern_set_add_states(set, entry))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * pattern_set_match_dynamic - Expands and matches one pattern.
+ * @shell: Pointer to the shell state.
+ * @word: The pattern word.
+ * @subject: The string to match.
+ * @length: Length of the string.
+ * @cache: Arithmetic cache of the case command.
+ * Return: true if the pattern matches, false otherwise or on error.
+ */
+static bool pattern_set_match_dynamic(ShellState *shell, const char *word,
+				      const char *subject, size_t length,
+				      Arith **cache)
+{
+	char *glob = expand_pattern(shell, word, cache);
+	Pattern *pattern = glob ? pattern_compile(glob) : NULL;
+	bool matched = pattern && pattern_match(pattern, subject, length);
+
+	if (!pattern && !shell->had_error)
+		shell->fatal_error = true;
+	pattern_free(pattern);
+	free(glob);
+	return matched;
+}
+
+/**
+ * pattern_set_match_globs - Runs the glob automaton over a string.
+ * @set: Pointer to the PatternSet.
+ * @subject: The string to match.
+ * @length: Length of the string.
+ * @best: The earliest arm already known to match, or -1.
+ *
+ * The globs of every arm before @best are matched at once, with one step
+ * per character of @subject over the states still alive. Active states
+ * are kept sorted, as each one only moves to itself or the next state.
+ *
+ * Return: The earliest arm among @best and the matching globs, or -1.
+ */
+static int pattern_set_match_globs(const PatternSet *set,
+				   const char *subject, size_t length,
+				   int best)
+{
+	size_t *active = set->active, *next = set->next, count = 0;
+
+	for (size_t i = 0; i < set->entry_count; i++) {
+		const PatternEntry *entry = &set->entries[i];
+		const Pattern *pattern = entry->pattern;
+
+		if (best >= 0 && entry->arm >= best)
+			break;
+		if (pattern && length >= pattern->min_length &&
+		    (pattern->has_star || length == pattern->min_length))
+			active[count++] = entry->start;
+	}
+
+	for (size_t i = 0; i < length && count > 0; i++) {
+		unsigned char c = subject[i];
+		size_t *swap, n = 0;
+
+		for (size_t j = 0; j < count; j++) {
+			const PatternState *state = &set->states[active[j]];
+			bool step;
+
+			if (state->star && (n == 0 || next[n - 1] != active[j]))
+				next[n++] = active[j];
+			if (state->arm >= 0)
+				continue;
+			if (state->opcode == PATTERN_LITERAL)
+				step = state->c == c;
+			else if (state->opcode == PATTERN_CLASS)
+				step = pattern_has_bit(state->set, c);
+			else
+				step = true;
+			if (step)
+				next[n++] = active[j] + 1;
+		}
+		swap = active;
+		active = next;
+		next = swap;
+		count = n;
+	}
+
+	for (size_t j = 0; j < count; j++) {
+		int arm = set->states[active[j]].arm;
+
+		if (arm >= 0 && (best < 0 || arm < best))
+			best = arm;
+	}
+	return best;
+}
+
+/**
+ * pattern_set_match - Finds the first case arm matching a string.
+ * @shell: Pointer to the shell state.
+ * @set: Pointer to the PatternSet.
+ * @subject: The expanded case word.
+ * @cache: Arithmetic cache of the case command.
+ *
+ * One hash lookup finds the earliest literal arm and one pass of the glob
+ * automaton the earliest glob arm before it; only the patterns of earlier
+ * arms that need expansion are then tried, in order.
+ *
+ * Return: Index of the matching arm, or -1 if none matches or on error.
+ */
+int pattern_set_match(ShellState *shell, const PatternSet *set,
+		      const char *subject, Arith **cache)
+{
+	size_t length = strlen(subject);
+	int best = -1;
+
+	if (set->bucket_count) {
+		size_t bucket = pattern_hash(subject, length) &
+				(set->bucket_count - 1);
+		for (PatternLiteral *lit = set->buckets[bucket]; lit;
+		     lit = lit->next) {
+			if (strcmp(lit->text, subject) == 0) {
+				best = lit->arm;
+				break;
+			}
+		}
+	}
+
+	if (set->state_count)
+		best = pattern_set_match_globs(set, subject, length, best);
+
+	for (size_t i = 0; i < set->entry_count; i++) {
+		const PatternEntry *entry = &set->entries[i];
+		bool matched;
+
+		if (best >= 0 && entry->arm >= best)
+			break;
+		if (entry->pattern)
+			continue;
+		matched = pattern_set_match_dynamic(shell, entry->word,
+						    subject, length, cache);
+		if (shell->had_error || shell->fatal_error)
+			return -1;
+		if (matched)
+			return entry->arm;
+	}
+	return best;
+}
+
+/**
+ * pattern_set_free - Frees a set of case patterns.
+ * @set: Pointer to the PatternSet, may be NULL.
+ */
+void pattern_set_free(PatternSet *set)
+{
+	if (!set)
+		return;
+	for (size_t i = 0; i < set->bucket_count; i++) {
+		PatternLiteral *lit = set->buckets[i];
+		while (lit) {
+			PatternLiteral *next = lit->next;
+			free(lit->text);
+			free(lit);
+			lit = next;
+		}
+	}
+	for (size_t i = 0; i < set->entry_count; i++)
+		pattern_free(set->entries[i].pattern);
+	free(set->buckets);
+	free(set->entries);
+	free(set->states);
+	free(set->active);
+	free(set->next);
+	free(set);
+}
@@ -0,0 +1,79 @@
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include "arith.h"
+#include "shell.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#define PATTERN_BUCKETS_MIN 8
+
+typedef enum PatternOpcode {
+	PATTERN_LITERAL,
+	PATTERN_ANY,
+	PATTERN_STAR,
+	PATTERN_CLASS,
+} PatternOpcode;
+
+typedef struct PatternOp {
+	PatternOpcode opcode;
+	const char *text;
+	size_t length;
+	unsigned char set[32];
+} PatternOp;
+
+typedef struct Pattern {
+	PatternOp *ops;
+	size_t count;
+	size_t min_length;
+	bool has_star;
+	char *text;
+} Pattern;
+
+typedef struct PatternLiteral {
+	char *text;
+	int arm;
+	struct PatternLiteral *next;
+} PatternLiteral;
+
+typedef struct PatternState {
+	PatternOpcode opcode;
+	bool star;
+	unsigned char c;
+	const unsigned char *set;
+	int arm;
+} PatternState;
+
+typedef struct PatternEntry {
+	int arm;
+	Pattern *pattern;
+	size_t start;
+	const char *word;
+} PatternEntry;
+
+typedef struct PatternSet {
+	PatternLiteral **buckets;
+	size_t bucket_count;
+	size_t literal_count;
+	PatternEntry *entries;
+	size_t entry_count;
+	size_t entry_capacity;
+	PatternState *states;
+	size_t state_count;
+	size_t state_capacity;
+	size_t *active;
+	size_t *next;
+} PatternSet;
+
+Pattern *pattern_compile(const char *glob);
+bool pattern_match(const Pattern *pattern, const char *subject,
+		   size_t length);
+void pattern_free(Pattern *pattern);
+
+PatternSet *pattern_set_new(void);
+bool pattern_set_add(PatternSet *set, const char *word, int arm);
+int pattern_set_match(ShellState *shell, const PatternSet *set,
+		      const char *subject, Arith **cache);
+void pattern_set_free(PatternSet *set);
+
+#endif
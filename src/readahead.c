@@ -0,0 +1,239 @@
+#include "readahead.h"
+#include "counters.h"
+#include "lexer.h"
+#include "output.h"
+#include "parser.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * readahead_push - Hands a parsed command to the shell.
+ * @ra: Pointer to the ReadAhead structure.
+ * @item: The item to queue.
+ *
+ * Blocks while the queue is full, so the helper never runs more than
+ * READAHEAD_QUEUE commands ahead of the shell.
+ *
+ * Return: true if the item was queued, false if the shell stopped reading.
+ */
+static bool readahead_push(ReadAhead *ra, ReadAheadItem *item)
+{
+	bool queued;
+
+	pthread_mutex_lock(&ra->lock);
+	while (ra->count == READAHEAD_QUEUE && !ra->stop)
+		pthread_cond_wait(&ra->changed, &ra->lock);
+	queued = !ra->stop;
+	if (queued) {
+		ra->items[(ra->head + ra->count) % READAHEAD_QUEUE] = *item;
+		ra->count++;
+		pthread_cond_broadcast(&ra->changed);
+	}
+	pthread_mutex_unlock(&ra->lock);
+	return queued;
+}
+
+/**
+ * readahead_item_free - Frees the contents of a queued item.
+ * @item: Pointer to the ReadAheadItem.
+ */
+static void readahead_item_free(ReadAheadItem *item)
+{
+	command_free(item->command);
+	token_free_list(item->tokens);
+	free(item->source);
+}
+
+/**
+ * readahead_append - Appends a line to the text of the current command.
+ * @source: Pointer to the text buffer.
+ * @length: Pointer to the length of the text.
+ * @capacity: Pointer to the allocated size of the buffer.
+ * @line: The line to append.
+ * @size: Length of the line.
+ * Return: true on success, false on allocation failure.
+ */
+static bool readahead_append(char **source, size_t *length, size_t *capacity,
+			     const char *line, size_t size)
+{
+	if (*length + size + 1 > *capacity) {
+		size_t new_capacity = (*length + size + 1) * 2;
+		char *buffer = realloc(*source, new_capacity);
+		if (!buffer)
+			return false;
+		*source = buffer;
+		*capacity = new_capacity;
+	}
+	memcpy(*source + *length, line, size + 1);
+	*length += size;
+	return true;
+}
+
+/**
+ * readahead_main - Reads and parses commands ahead of the shell.
+ * @arg: Pointer to the ReadAhead structure.
+ *
+ * The lexer and parser only touch the private ShellState of the helper.
+ * A command that fails to lex or parse is queued as text instead, and its
+ * error output is dropped; the shell parses it again when its turn comes,
+ * so errors are reported in order and with the shell's own state.
+ *
+ * Return: NULL.
+ */
+static void *readahead_main(void *arg)
+{
+	ReadAhead *ra = arg;
+	ShellState *state = &ra->state;
+	char *line = NULL, *source = NULL;
+	size_t n = 0, length = 0, capacity = 0;
+	bool at_eof = false;
+	Lexer lex;
+
+	lexer_init(&lex, state);
+	while (!at_eof) {
+		ssize_t nread;
+
+		state->line_number++;
+		nread = getline(&line, &n, ra->stream);
+		if (nread < 0) {
+			if (!lexer_needs_more(&lex))
+				break;
+			at_eof = true;
+		} else {
+			counter_add(COUNTER_LINES, 1);
+			if (!readahead_append(&source, &length, &capacity, line,
+					      nread))
+				state->fatal_error = true;
+			lexer_feed(&lex, line);
+			if (lexer_needs_more(&lex) && !state->fatal_error)
+				continue;
+		}
+
+		ReadAheadItem item = { .line_number = state->line_number };
+		item.tokens = lexer_finish(&lex);
+		if (!state->had_error && !state->fatal_error)
+			item.command = parse(state, item.tokens);
+
+		if (state->had_error || state->fatal_error) {
+			token_free_list(item.tokens);
+			item.tokens = NULL;
+			item.source = source ? source : strdup("");
+			source = NULL;
+			capacity = 0;
+			state->had_error = false;
+			state->fatal_error = false;
+			output_discard_all();
+		} else if (!item.command) {
+			/* a blank or comment line: nothing to run */
+			token_free_list(item.tokens);
+			length = 0;
+			continue;
+		}
+		length = 0;
+
+		if (!readahead_push(ra, &item)) {
+			readahead_item_free(&item);
+			break;
+		}
+	}
+
+	free(line);
+	free(source);
+	output_discard_all();
+	pthread_mutex_lock(&ra->lock);
+	ra->done = true;
+	pthread_cond_broadcast(&ra->changed);
+	pthread_mutex_unlock(&ra->lock);
+	return NULL;
+}
+
+/**
+ * readahead_start - Starts reading and parsing a script in a helper thread.
+ * @ra: Pointer to the ReadAhead structure.
+ * @shell: Pointer to the shell state.
+ * @stream: The script; only the helper reads it until readahead_stop.
+ * Return: true on success, false if the thread could not be started.
+ */
+bool readahead_start(ReadAhead *ra, ShellState *shell, FILE *stream)
+{
+	memset(ra, 0, sizeof(*ra));
+	ra->stream = stream;
+	ra->state.name = shell->name;
+	ra->state.line_number = shell->line_number;
+	ra->state.strings = shell->strings;
+
+	if (pthread_mutex_init(&ra->lock, NULL) != 0)
+		return false;
+	if (pthread_cond_init(&ra->changed, NULL) != 0) {
+		pthread_mutex_destroy(&ra->lock);
+		return false;
+	}
+	if (pthread_create(&ra->thread, NULL, readahead_main, ra) != 0) {
+		pthread_cond_destroy(&ra->changed);
+		pthread_mutex_destroy(&ra->lock);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * readahead_next - Takes the next command, waiting for it if needed.
+ * @ra: Pointer to the ReadAhead structure.
+ * @item: Receives the command; the caller owns its contents. Either
+ *        tokens and command are set, or source holds text to parse again.
+ * Return: true if a command was taken, false at the end of the script.
+ */
+bool readahead_next(ReadAhead *ra, ReadAheadItem *item)
+{
+	bool found;
+
+	pthread_mutex_lock(&ra->lock);
+	while (ra->count == 0 && !ra->done)
+		pthread_cond_wait(&ra->changed, &ra->lock);
+	found = ra->count > 0;
+	if (found) {
+		*item = ra->items[ra->head];
+		ra->head = (ra->head + 1) % READAHEAD_QUEUE;
+		ra->count--;
+		pthread_cond_broadcast(&ra->changed);
+	}
+	pthread_mutex_unlock(&ra->lock);
+	return found;
+}
+
+/**
+ * readahead_at_end - Checks if the script has no more commands.
+ * @ra: Pointer to the ReadAhead structure.
+ * Return: true if readahead_next would return false.
+ */
+bool readahead_at_end(ReadAhead *ra)
+{
+	bool at_end;
+
+	pthread_mutex_lock(&ra->lock);
+	while (ra->count == 0 && !ra->done)
+		pthread_cond_wait(&ra->changed, &ra->lock);
+	at_end = ra->count == 0;
+	pthread_mutex_unlock(&ra->lock);
+	return at_end;
+}
+
+/**
+ * readahead_stop - Stops the helper thread and frees unused commands.
+ * @ra: Pointer to the ReadAhead structure.
+ */
+void readahead_stop(ReadAhead *ra)
+{
+	pthread_mutex_lock(&ra->lock);
+	ra->stop = true;
+	pthread_cond_broadcast(&ra->changed);
+	pthread_mutex_unlock(&ra->lock);
+	pthread_join(ra->thread, NULL);
+
+	for (; ra->count > 0; ra->count--) {
+		readahead_item_free(&ra->items[ra->head]);
+		ra->head = (ra->head + 1) % READAHEAD_QUEUE;
+	}
+	pthread_cond_destroy(&ra->changed);
+	pthread_mutex_destroy(&ra->lock);
+}
@@ -0,0 +1,38 @@
+#ifndef READAHEAD_H
+#define READAHEAD_H
+
+#include "command.h"
+#include "shell.h"
+#include "token.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define READAHEAD_QUEUE 16
+
+typedef struct ReadAheadItem {
+	Token *tokens;
+	Command *command;
+	char *source;
+	int line_number;
+} ReadAheadItem;
+
+typedef struct ReadAhead {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	ReadAheadItem items[READAHEAD_QUEUE];
+	int head;
+	int count;
+	bool done;
+	bool stop;
+	FILE *stream;
+	ShellState state;
+} ReadAhead;
+
+bool readahead_start(ReadAhead *ra, ShellState *shell, FILE *stream);
+bool readahead_next(ReadAhead *ra, ReadAheadItem *item);
+bool readahead_at_end(ReadAhead *ra);
+void readahead_stop(ReadAhead *ra);
+
+#endif
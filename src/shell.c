@@ -1,11 +1,21 @@
 #include "shell.h"
 #include "command.h"
+#include "counters.h"
 #include "executor.h"
+#include "jobs.h"
 #include "lexer.h"
+#include "output.h"
+#include "parallel.h"
 #include "parser.h"
+#include "readahead.h"
 #include "token.h"
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern char **environ;
+
 /**
  * shell_init - Initializes the shell state.
  * @name: Name of the shell executable.
@@ -21,9 +31,41 @@ ShellState *shell_init(char *name, bool is_interactive)
 
 	shell->fatal_error = false;
 	shell->had_error = false;
+	shell->exit_requested = false;
+	shell->tail_exec = false;
+	shell->return_requested = false;
+	shell->read_ahead = false;
+	shell->child_usage = NULL;
 	shell->is_interactive_mode = is_interactive;
 	shell->line_number = 0;
+	shell->last_status = 0;
 	shell->name = name;
+	shell->pid = getpid();
+	shell->last_job_pid = 0;
+	shell->loop_depth = 0;
+	shell->break_count = 0;
+	shell->continue_count = 0;
+	shell->function_depth = 0;
+	shell->positional = NULL;
+	shell->positional_count = 0;
+	function_table_init(&shell->functions);
+	shell->jobs = NULL;
+	shell->parallel = NULL;
+	shell->strings = intern_table_new();
+	if (!shell->strings) {
+		free(shell);
+		return NULL;
+	}
+	if (!var_init(&shell->vars, environ)) {
+		var_free(&shell->vars);
+		intern_table_free(shell->strings);
+		free(shell);
+		return NULL;
+	}
+	jobserver_init_client(&shell->jobserver);
+	/* children add to the counters the shell reports */
+	counters_share();
+	shell->metrics = metrics_start(name);
 	return shell;
 }
 /**
@@ -32,87 +74,214 @@ ShellState *shell_init(char *name, bool is_interactive)
  */
 void shell_free(ShellState *shell)
 {
+	/* tokens held by running jobs must go back to the shared pool */
+	if (shell->jobserver.is_active)
+		job_reap(shell, true);
+	job_free_list(shell);
+	parallel_free(shell->parallel);
+	metrics_stop(shell->metrics);
+	jobserver_close(&shell->jobserver);
+	output_flush_all();
+	function_table_free(&shell->functions);
+	intern_table_free(shell->strings);
+	var_free(&shell->vars);
 	free(shell);
 }
 
 /**
- * shell_repl - Runs the Read-Eval-Print Loop (REPL) for the shell.
+ * shell_input_is_peekable - Checks if looking ahead in a stream never blocks.
  * @shell: Pointer to the ShellState structure.
  * @stream: Input stream to read commands from.
+ *
+ * Return: true for memory streams and regular files read non-interactively.
  */
-void shell_repl(ShellState *shell, FILE *stream)
+static bool shell_input_is_peekable(ShellState *shell, FILE *stream)
 {
-	char *line = NULL;
-	size_t n = 0;
-	ssize_t nread = 0;
+	struct stat st;
+	int fd = fileno(stream);
 
-	while (true) {
-start:
-		shell->line_number++;
-		if (shell->is_interactive_mode)
-			fprintf(stdout, "$ ");
+	if (shell->is_interactive_mode)
+		return false;
+	if (fd < 0)
+		return true;
+	return fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+}
 
-		nread = getline(&line, &n, stream);
-		if (nread < 0) {
-			free(line);
-			break;
-		}
+/**
+ * shell_at_end_of_input - Checks if a stream has no more input.
+ * @stream: Input stream to read commands from.
+ * Return: true if the next read would hit end of file.
+ */
+static bool shell_at_end_of_input(FILE *stream)
+{
+	int c = getc(stream);
+
+	if (c == EOF)
+		return true;
+	ungetc(c, stream);
+	return false;
+}
 
-		Token *tokens = tokenize(shell, line);
-		free(line);
-		line = NULL;
+/**
+ * shell_run_tokens - Parses and runs one complete command.
+ * @shell: Pointer to the ShellState structure.
+ * @tokens: The tokens of the command, freed here.
+ * @command: The command tree already parsed from @tokens, or NULL to parse
+ *           them here; freed here.
+ * @at_end: true if no more input follows the command.
+ *
+ * Return: false if the shell must stop reading input, true otherwise.
+ */
+static bool shell_run_tokens(ShellState *shell, Token *tokens,
+			     Command *command, bool at_end)
+{
+	if (shell->fatal_error) {
+		token_free_list(tokens);
+		return false;
+	}
+	if (shell->had_error) {
+		counter_add(COUNTER_PARSE_ERRORS, 1);
+		token_free_list(tokens);
+		shell->had_error = false;
+		return true;
+	}
 
+	if (!command) {
+		command = parse(shell, tokens);
 		if (shell->fatal_error) {
 			token_free_list(tokens);
-			return;
+			return false;
 		}
 		if (shell->had_error) {
-			token_free_list(tokens);
+			counter_add(COUNTER_PARSE_ERRORS, 1);
 			shell->had_error = false;
-			continue;
+			shell->last_status = 2;
+			token_free_list(tokens);
+			return shell->is_interactive_mode;
 		}
+	}
 
-		Token **commands = token_split_by_semicolon(shell, tokens);
-		if (shell->fatal_error) {
-			Token **runner = commands;
-			while (*runner) {
-				token_free_list(*runner);
-				runner++;
-			}
-			free(commands);
+	/* with -P, lines that cannot change the shell run side by side and
+	 * any other line waits for them */
+	if (shell->parallel && command) {
+		if (execute_is_stateless(shell, command)) {
+			if (!parallel_start(shell->parallel, shell, command))
+				shell->last_status = 2;
+			command_free(command);
+			token_free_list(tokens);
+			return !shell->fatal_error;
+		}
+		parallel_finish(shell->parallel, shell);
+	}
+
+	/* nothing follows: the final command may replace us */
+	shell->tail_exec = at_end;
+	execute_command(shell, command);
+	shell->tail_exec = false;
+	command_free(command);
+	token_free_list(tokens);
+
+	if (shell->fatal_error || shell->exit_requested)
+		return false;
+	if (shell->had_error) {
+		shell->had_error = false;
+		if (!shell->is_interactive_mode)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * shell_repl_readahead - Runs commands parsed ahead by a helper thread.
+ * @shell: Pointer to the ShellState structure.
+ * @ra: Pointer to the started ReadAhead structure.
+ *
+ * Commands the helper could not parse arrive as text and are lexed and
+ * parsed again here, in order, so that their errors are reported after
+ * the output of the commands before them.
+ */
+static void shell_repl_readahead(ShellState *shell, ReadAhead *ra)
+{
+	ReadAheadItem item;
+
+	while (readahead_next(ra, &item)) {
+		shell->line_number = item.line_number;
+		job_reap(shell, false);
+		if (!item.command && !item.source) {
+			shell->fatal_error = true;
 			return;
 		}
+		if (!item.command) {
+			item.tokens = tokenize(shell, item.source);
+			free(item.source);
+		}
+		if (!shell_run_tokens(shell, item.tokens, item.command,
+				      readahead_at_end(ra)))
+			return;
+	}
+}
 
-		Token **ptr = commands;
-		for (; *ptr; ptr++) {
-			Command *command = parse(shell, *ptr);
-			execute_command(command);
-			command_free(command);
+/**
+ * shell_repl - Runs the Read-Eval-Print Loop (REPL) for the shell.
+ * @shell: Pointer to the ShellState structure.
+ * @stream: Input stream to read commands from.
+ *
+ * With read_ahead set, a script is read and parsed by a helper thread
+ * while the shell waits for the commands before it to finish.
+ */
+void shell_repl(ShellState *shell, FILE *stream)
+{
+	char *line = NULL;
+	size_t n = 0;
+	ssize_t nread = 0;
+	bool peekable = shell_input_is_peekable(shell, stream);
+	bool at_eof = false;
+	Lexer lex;
+
+	if (shell->read_ahead && peekable) {
+		ReadAhead ra;
+
+		if (readahead_start(&ra, shell, stream)) {
+			shell_repl_readahead(shell, &ra);
+			readahead_stop(&ra);
+			return;
+		}
+	}
 
-			if (shell->fatal_error) {
-				while (*ptr) {
-					token_free_list(*ptr);
-					ptr++;
-				}
-				free(commands);
-				return;
-			}
-			if (shell->had_error) {
-				shell->had_error = false;
-				while (*ptr) {
-					token_free_list(*ptr);
-					ptr++;
-				}
-				free(commands);
-				if (shell->is_interactive_mode)
-					goto start;
-				return;
-			}
-			token_free_list(*ptr);
+	lexer_init(&lex, shell);
+	while (!at_eof) {
+		shell->line_number++;
+		job_reap(shell, false);
+		if (shell->is_interactive_mode) {
+			output_puts(STDOUT_FILENO,
+				    lexer_needs_more(&lex) ? "> " : "$ ");
+			output_flush_all();
+		}
+
+		nread = getline(&line, &n, stream);
+		if (nread < 0) {
+			free(line);
+			line = NULL;
+			if (!lexer_needs_more(&lex))
+				break;
+			at_eof = true;
+		} else {
+			counter_add(COUNTER_LINES, 1);
+			/* continuation lines resume where the lexer stopped */
+			lexer_feed(&lex, line);
+			free(line);
+			line = NULL;
+			if (lexer_needs_more(&lex) && !shell->fatal_error)
+				continue;
 		}
-		free(commands);
+
+		Token *tokens = lexer_finish(&lex);
+		bool at_end = peekable && shell_at_end_of_input(stream);
+
+		if (!shell_run_tokens(shell, tokens, NULL, at_end))
+			return;
 	}
 
 	if (shell->is_interactive_mode)
-		putchar('\n');
+		output_putc(STDOUT_FILENO, '\n');
 }
@@ -1,15 +1,43 @@
 #ifndef SHELL_H
 #define SHELL_H
 
+#include "functions.h"
+#include "intern.h"
+#include "jobserver.h"
+#include "metrics.h"
+#include "var.h"
 #include <stdbool.h>
 #include <stdio.h>
+#include <sys/resource.h>
+#include <sys/types.h>
 
 typedef struct ShellState {
 	bool fatal_error;
 	bool is_interactive_mode;
 	bool had_error;
+	bool exit_requested;
+	bool tail_exec;
+	bool return_requested;
+	bool read_ahead;
+	struct rusage *child_usage;
 	char *name;
 	int line_number;
+	int last_status;
+	pid_t pid;
+	pid_t last_job_pid;
+	int loop_depth;
+	int break_count;
+	int continue_count;
+	int function_depth;
+	char **positional;
+	int positional_count;
+	VarTable vars;
+	FunctionTable functions;
+	InternTable *strings;
+	struct Job *jobs;
+	struct Parallel *parallel;
+	JobServer jobserver;
+	MetricsExporter *metrics;
 } ShellState;
 
 ShellState *shell_init(char *name, bool is_interactive);
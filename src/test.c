@@ -0,0 +1,487 @@
+#include "test.h"
+#include "output.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct TestStat {
+	const char *path;
+	bool nofollow;
+	bool found;
+	struct stat st;
+} TestStat;
+
+typedef struct TestState {
+	ShellState *shell;
+	const char *name;
+	char **argv;
+	int argc;
+	int pos;
+	bool error;
+	TestStat cache[TEST_STAT_CACHE];
+	int cached;
+} TestState;
+
+static bool test_or(TestState *t);
+
+/**
+ * test_error - Reports a malformed test expression.
+ * @t: Pointer to the TestState.
+ * @arg: The offending argument, or NULL.
+ * @message: Description of the problem.
+ */
+static void test_error(TestState *t, const char *arg, const char *message)
+{
+	if (t->error)
+		return;
+	t->error = true;
+	if (arg)
+		output_printf(STDERR_FILENO, "%s: %d: %s: %s: %s\n",
+			      t->shell->name, t->shell->line_number, t->name,
+			      arg, message);
+	else
+		output_printf(STDERR_FILENO, "%s: %d: %s: %s\n",
+			      t->shell->name, t->shell->line_number, t->name,
+			      message);
+}
+
+/**
+ * test_stat - Stats a path, reusing earlier results for the same path.
+ * @t: Pointer to the TestState.
+ * @path: The path.
+ * @nofollow: Do not follow a final symbolic link.
+ *
+ * An expression such as "-f x -a -r x -a -s x" only stats x once.
+ *
+ * Return: Pointer to the stat result, or NULL if the path does not exist.
+ */
+static const struct stat *test_stat(TestState *t, const char *path,
+				    bool nofollow)
+{
+	int count = t->cached < TEST_STAT_CACHE ? t->cached : TEST_STAT_CACHE;
+
+	for (int i = 0; i < count; i++) {
+		TestStat *entry = &t->cache[i];
+		if (entry->nofollow == nofollow &&
+		    strcmp(entry->path, path) == 0)
+			return entry->found ? &entry->st : NULL;
+	}
+
+	TestStat *entry = &t->cache[t->cached++ % TEST_STAT_CACHE];
+	entry->path = path;
+	entry->nofollow = nofollow;
+	entry->found = fstatat(AT_FDCWD, path, &entry->st,
+			       nofollow ? AT_SYMLINK_NOFOLLOW : 0) == 0;
+	return entry->found ? &entry->st : NULL;
+}
+
+/**
+ * test_number - Parses an integer operand.
+ * @t: Pointer to the TestState.
+ * @arg: The operand.
+ * Return: The value, or 0 after reporting an error.
+ */
+static long long test_number(TestState *t, const char *arg)
+{
+	char *end;
+	long long value;
+
+	errno = 0;
+	value = strtoll(arg, &end, 10);
+	while (*end == ' ' || *end == '\t')
+		end++;
+	if (end == arg || *end || errno == ERANGE) {
+		test_error(t, arg, "Illegal number");
+		return 0;
+	}
+	return value;
+}
+
+/**
+ * test_newer - Compares the modification times of two files.
+ * @a: Stat result of the first file, or NULL if it does not exist.
+ * @b: Stat result of the second file, or NULL if it does not exist.
+ * Return: true if @a exists and is newer than @b or @b does not exist.
+ */
+static bool test_newer(const struct stat *a, const struct stat *b)
+{
+	if (!a)
+		return false;
+	if (!b)
+		return true;
+	if (a->st_mtim.tv_sec != b->st_mtim.tv_sec)
+		return a->st_mtim.tv_sec > b->st_mtim.tv_sec;
+	return a->st_mtim.tv_nsec > b->st_mtim.tv_nsec;
+}
+
+/**
+ * test_is_binary - Checks whether an argument is a binary operator.
+ * @op: The argument.
+ * Return: true if @op is a binary operator.
+ */
+static bool test_is_binary(const char *op)
+{
+	static const char *const ops[] = {
+		"=",   "!=",  "<",   ">",   "-eq", "-ne", "-lt",
+		"-le", "-gt", "-ge", "-nt", "-ot", "-ef",
+	};
+
+	for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+		if (strcmp(op, ops[i]) == 0)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * test_binary - Evaluates a binary operator.
+ * @t: Pointer to the TestState.
+ * @left: The left operand.
+ * @op: The operator.
+ * @right: The right operand.
+ * Return: The result of the comparison.
+ */
+static bool test_binary(TestState *t, const char *left, const char *op,
+			const char *right)
+{
+	if (strcmp(op, "=") == 0)
+		return strcmp(left, right) == 0;
+	if (strcmp(op, "!=") == 0)
+		return strcmp(left, right) != 0;
+	if (strcmp(op, "<") == 0)
+		return strcmp(left, right) < 0;
+	if (strcmp(op, ">") == 0)
+		return strcmp(left, right) > 0;
+
+	if (strcmp(op, "-nt") == 0)
+		return test_newer(test_stat(t, left, false),
+				  test_stat(t, right, false));
+	if (strcmp(op, "-ot") == 0)
+		return test_newer(test_stat(t, right, false),
+				  test_stat(t, left, false));
+	if (strcmp(op, "-ef") == 0) {
+		const struct stat *a = test_stat(t, left, false);
+		const struct stat *b = test_stat(t, right, false);
+		return a && b && a->st_dev == b->st_dev &&
+		       a->st_ino == b->st_ino;
+	}
+
+	long long a = test_number(t, left);
+	long long b = test_number(t, right);
+
+	if (strcmp(op, "-eq") == 0)
+		return a == b;
+	if (strcmp(op, "-ne") == 0)
+		return a != b;
+	if (strcmp(op, "-lt") == 0)
+		return a < b;
+	if (strcmp(op, "-le") == 0)
+		return a <= b;
+	if (strcmp(op, "-gt") == 0)
+		return a > b;
+	return a >= b;
+}
+
+/**
+ * test_in_group - Checks whether the shell is in a group.
+ * @gid: The group ID.
+ *
+ * The supplementary groups are read once; the shell never changes them.
+ *
+ * Return: true for the effective group and supplementary groups.
+ */
+static bool test_in_group(gid_t gid)
+{
+	static gid_t *groups;
+	static int count = -1;
+
+	if (gid == getegid())
+		return true;
+	if (count < 0) {
+		int n = getgroups(0, NULL);
+
+		groups = n > 0 ? malloc(sizeof(gid_t) * n) : NULL;
+		count = groups ? getgroups(n, groups) : 0;
+		if (count < 0)
+			count = 0;
+	}
+	for (int i = 0; i < count; i++) {
+		if (groups[i] == gid)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * test_access - Works out -r, -w or -x from the cached stat result.
+ * @st: The stat result of the file.
+ * @other: S_IROTH, S_IWOTH or S_IXOTH.
+ *
+ * Like dash, the owner, group or other permission bits are checked for
+ * the effective user, and root may read and write anything and execute
+ * anything with an execute bit set. Access control lists and read-only
+ * mounts are not taken into account.
+ *
+ * Return: true if the access is allowed.
+ */
+static bool test_access(const struct stat *st, mode_t other)
+{
+	uid_t euid = geteuid();
+
+	if (euid == 0) {
+		if (other != S_IXOTH)
+			return true;
+		return st->st_mode & (S_IXUSR | S_IXGRP | S_IXOTH);
+	}
+	if (st->st_uid == euid)
+		return st->st_mode & (other << 6);
+	if (test_in_group(st->st_gid))
+		return st->st_mode & (other << 3);
+	return st->st_mode & other;
+}
+
+/**
+ * test_unary - Evaluates a unary operator.
+ * @t: Pointer to the TestState.
+ * @op: The operator.
+ * @arg: The operand.
+ * @result: Set to the result.
+ * Return: true if @op is a unary operator, false otherwise.
+ */
+static bool test_unary(TestState *t, const char *op, const char *arg,
+		       bool *result)
+{
+	const struct stat *st;
+
+	if (op[0] != '-' || !op[1] || op[2])
+		return false;
+
+	switch (op[1]) {
+	case 'n':
+		*result = *arg != '\0';
+		return true;
+	case 'z':
+		*result = *arg == '\0';
+		return true;
+	case 't':
+		*result = isatty((int)test_number(t, arg));
+		return true;
+	case 'h':
+	case 'L':
+		st = test_stat(t, arg, true);
+		*result = st && S_ISLNK(st->st_mode);
+		return true;
+	case 'b':
+	case 'c':
+	case 'd':
+	case 'e':
+	case 'f':
+	case 'g':
+	case 'k':
+	case 'p':
+	case 'r':
+	case 's':
+	case 'S':
+	case 'u':
+	case 'w':
+	case 'x':
+	case 'O':
+	case 'G':
+		break;
+	default:
+		return false;
+	}
+
+	st = test_stat(t, arg, false);
+	if (!st) {
+		*result = false;
+		return true;
+	}
+
+	switch (op[1]) {
+	case 'b':
+		*result = S_ISBLK(st->st_mode);
+		break;
+	case 'c':
+		*result = S_ISCHR(st->st_mode);
+		break;
+	case 'd':
+		*result = S_ISDIR(st->st_mode);
+		break;
+	case 'f':
+		*result = S_ISREG(st->st_mode);
+		break;
+	case 'g':
+		*result = st->st_mode & S_ISGID;
+		break;
+	case 'k':
+		*result = st->st_mode & S_ISVTX;
+		break;
+	case 'p':
+		*result = S_ISFIFO(st->st_mode);
+		break;
+	case 'r':
+		*result = test_access(st, S_IROTH);
+		break;
+	case 's':
+		*result = st->st_size > 0;
+		break;
+	case 'S':
+		*result = S_ISSOCK(st->st_mode);
+		break;
+	case 'u':
+		*result = st->st_mode & S_ISUID;
+		break;
+	case 'w':
+		*result = test_access(st, S_IWOTH);
+		break;
+	case 'x':
+		*result = test_access(st, S_IXOTH);
+		break;
+	case 'O':
+		*result = st->st_uid == geteuid();
+		break;
+	case 'G':
+		*result = st->st_gid == getegid();
+		break;
+	default:
+		*result = true;
+		break;
+	}
+	return true;
+}
+
+/**
+ * test_primary - Evaluates a parenthesised expression or a single test.
+ * @t: Pointer to the TestState.
+ * Return: The result of the expression.
+ */
+static bool test_primary(TestState *t)
+{
+	int left = t->argc - t->pos;
+	char **args = t->argv + t->pos;
+	bool result;
+
+	if (left <= 0) {
+		test_error(t, NULL, "argument expected");
+		return false;
+	}
+
+	if (left >= 3 && test_is_binary(args[1])) {
+		t->pos += 3;
+		return test_binary(t, args[0], args[1], args[2]);
+	}
+	if (strcmp(args[0], "(") == 0 && left >= 2) {
+		t->pos++;
+		result = test_or(t);
+		if (t->pos >= t->argc || strcmp(t->argv[t->pos], ")") != 0) {
+			test_error(t, NULL, "closing paren expected");
+			return false;
+		}
+		t->pos++;
+		return result;
+	}
+	if (left >= 2 && test_unary(t, args[0], args[1], &result)) {
+		t->pos += 2;
+		return result;
+	}
+	t->pos++;
+	return *args[0] != '\0';
+}
+
+/**
+ * test_not - Evaluates an expression with optional "!" negations.
+ * @t: Pointer to the TestState.
+ * Return: The result of the expression.
+ */
+static bool test_not(TestState *t)
+{
+	if (t->pos + 1 < t->argc && strcmp(t->argv[t->pos], "!") == 0) {
+		t->pos++;
+		return !test_not(t);
+	}
+	return test_primary(t);
+}
+
+/**
+ * test_and - Evaluates expressions joined by "-a".
+ * @t: Pointer to the TestState.
+ * Return: The result of the expression.
+ */
+static bool test_and(TestState *t)
+{
+	bool result = test_not(t);
+
+	while (!t->error && t->pos < t->argc &&
+	       strcmp(t->argv[t->pos], "-a") == 0) {
+		t->pos++;
+		result = test_not(t) && result;
+	}
+	return result;
+}
+
+/**
+ * test_or - Evaluates expressions joined by "-o".
+ * @t: Pointer to the TestState.
+ * Return: The result of the expression.
+ */
+static bool test_or(TestState *t)
+{
+	bool result = test_and(t);
+
+	while (!t->error && t->pos < t->argc &&
+	       strcmp(t->argv[t->pos], "-o") == 0) {
+		t->pos++;
+		result = test_and(t) || result;
+	}
+	return result;
+}
+
+/**
+ * test_command - Runs the test and [ builtins.
+ * @shell: Pointer to the shell state.
+ * @argc: Number of arguments.
+ * @argv: Argument vector.
+ *
+ * File operators share one stat result per path and symlink mode for the
+ * whole expression; -r, -w and -x are also answered from it, so they
+ * ignore access control lists and read-only mounts.
+ *
+ * Return: 0 if the expression is true, 1 if false, 2 on a syntax error.
+ */
+int test_command(ShellState *shell, int argc, char **argv)
+{
+	TestState t = { .shell = shell, .name = argv[0], .argv = argv + 1 };
+
+	if (strcmp(argv[0], "[") == 0) {
+		if (strcmp(argv[argc - 1], "]") != 0) {
+			test_error(&t, NULL, "missing ]");
+			return 2;
+		}
+		argc--;
+	}
+	t.argc = argc - 1;
+	if (t.argc == 0)
+		return 1;
+
+	bool result;
+
+	/* POSIX: of three arguments, a binary operator in the middle wins */
+	if (t.argc == 3 && test_is_binary(t.argv[1])) {
+		result = test_binary(&t, t.argv[0], t.argv[1], t.argv[2]);
+		if (t.error)
+			return 2;
+		return result ? 0 : 1;
+	}
+
+	result = test_or(&t);
+	if (!t.error && t.pos < t.argc)
+		test_error(&t, t.argv[t.pos], "unexpected operator");
+	if (t.error)
+		return 2;
+	return result ? 0 : 1;
+}
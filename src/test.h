@@ -0,0 +1,10 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include "shell.h"
+
+#define TEST_STAT_CACHE 8
+
+int test_command(ShellState *shell, int argc, char **argv);
+
+#endif
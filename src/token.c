@@ -1,5 +1,28 @@
 #include "token.h"
+#include "intern.h"
 #include <stdlib.h>
+
+/**
+ * token_is_redirection - Checks if a token starts a redirection.
+ * @type: The type of the token.
+ * Return: true for a redirection operator or the descriptor before one.
+ */
+bool token_is_redirection(TokenType type)
+{
+	switch (type) {
+	case TOKEN_REDIRECT_IN:
+	case TOKEN_REDIRECT_OUT:
+	case TOKEN_REDIRECT_APPEND:
+	case TOKEN_REDIRECT_READ_WRITE:
+	case TOKEN_REDIRECT_DUP_IN:
+	case TOKEN_REDIRECT_DUP_OUT:
+	case TOKEN_IO_NUMBER:
+		return true;
+	default:
+		return false;
+	}
+}
+
 /**
  * token_free_list - Frees a linked list of tokens.
  * @head: Pointer to the head of the token list.
@@ -12,85 +35,10 @@ void token_free_list(Token *head)
 	while (current != NULL) {
 		next = current->next;
 		if (current->type == TOKEN_WORD ||
-		    current->type == TOKEN_ASSIGNMENT_WORD)
-			free(current->lexeme);
+		    current->type == TOKEN_ASSIGNMENT_WORD ||
+		    current->type == TOKEN_IO_NUMBER)
+			intern_release(current->lexeme);
 		free(current);
 		current = next;
 	}
 }
-
-/**
- * token_split_by_semicolon - Splits a linked list of tokens into multiple
- *                            lists at each semicolon token.
- * @shell: Pointer to the shell state.
- * @tokens: Pointer to the head of the token list.
- *
- * Return: An array of pointers to the heads of the split token lists.
- *         The array is NULL-terminated. Returns NULL on memory allocation failure.
- */
-Token **token_split_by_semicolon(ShellState *shell, Token *tokens)
-{
-	Token **commands;
-	Token *current = tokens, *prev = NULL, *next = NULL, *start = tokens;
-	Token *node = malloc(sizeof(Token));
-	size_t count = 0, index = 0;
-
-	if (!node) {
-		shell->fatal_error = true;
-		return NULL;
-	}
-
-	count++;
-	while (current) {
-		if (current->type == TOKEN_SEMICOLON)
-			count++;
-		current = current->next;
-	}
-
-	commands = malloc(sizeof(Token *) * (count + 1));
-	if (!commands) {
-		shell->fatal_error = true;
-		free(node);
-		return NULL;
-	}
-
-	current = tokens;
-	start = current;
-	while (current) {
-		next = current->next;
-		if (current->type == TOKEN_SEMICOLON) {
-			node->type = TOKEN_EOL;
-			node->lexeme = "\n";
-			node->next = NULL;
-			if (!prev) {
-				commands[index++] = node;
-			} else {
-				prev->next = node;
-				commands[index++] = start;
-			}
-			start = next;
-			node = malloc(sizeof(Token));
-			if (!node) {
-				shell->fatal_error = true;
-				commands[index] = NULL;
-				return commands;
-			}
-		}
-		prev = current->type == TOKEN_SEMICOLON ? NULL : current;
-		if (current->type == TOKEN_SEMICOLON)
-			free(current);
-		current = next;
-	}
-
-	node->type = TOKEN_EOL;
-	node->lexeme = "\n";
-	node->next = NULL;
-	if (!prev) {
-		commands[index++] = node;
-	} else {
-		prev->next = node;
-		commands[index++] = start;
-	}
-	commands[index] = NULL;
-	return commands;
-}
@@ -10,11 +10,19 @@ typedef enum TokenType {
 	TOKEN_AND,
 	TOKEN_OR,
 	TOKEN_SEMICOLON,
+	TOKEN_DSEMI,
 	TOKEN_BACKGROUND,
 	TOKEN_REDIRECT_IN,
 	TOKEN_REDIRECT_OUT,
 	TOKEN_REDIRECT_APPEND,
+	TOKEN_REDIRECT_READ_WRITE,
+	TOKEN_REDIRECT_DUP_IN,
+	TOKEN_REDIRECT_DUP_OUT,
+	TOKEN_IO_NUMBER,
+	TOKEN_LPAREN,
+	TOKEN_RPAREN,
 	TOKEN_EOL,
+	TOKEN_EOF,
 } TokenType;
 
 typedef struct Token {
@@ -23,7 +31,7 @@ typedef struct Token {
 	struct Token *next;
 } Token;
 
+bool token_is_redirection(TokenType type);
 void token_free_list(Token *head);
-Token **token_split_by_semicolon(ShellState *shell, Token *tokens);
 
 #endif
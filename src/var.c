@@ -0,0 +1,348 @@
+#include "var.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * var_hash - Computes the bucket of a variable name.
+ * @name: The variable name.
+ * @length: Length of the name.
+ * Return: The bucket index.
+ */
+static size_t var_hash(const char *name, size_t length)
+{
+	unsigned int hash = 2166136261u;
+
+	for (size_t i = 0; i < length; i++)
+		hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+	return hash % VAR_BUCKETS;
+}
+
+/**
+ * var_lookup - Finds a variable by name.
+ * @vars: Pointer to the VarTable structure.
+ * @name: The variable name, not necessarily NUL-terminated.
+ * @length: Length of the name.
+ * Return: Pointer to the Variable, or NULL if it is not set.
+ */
+static Variable *var_lookup(VarTable *vars, const char *name, size_t length)
+{
+	Variable *var = vars->buckets[var_hash(name, length)];
+
+	for (; var; var = var->next) {
+		if (strncmp(var->name, name, length) == 0 &&
+		    var->name[length] == '\0')
+			return var;
+	}
+	return NULL;
+}
+
+/**
+ * var_store - Sets a variable from a name of known length.
+ * @vars: Pointer to the VarTable structure.
+ * @name: The variable name, not necessarily NUL-terminated.
+ * @length: Length of the name.
+ * @value: The new value.
+ * @export: Mark the variable for export to child processes.
+ *
+ * The value buffer of an existing variable is reused when it is large
+ * enough, so updating a loop counter does not allocate.
+ *
+ * Return: true on success, false on allocation failure.
+ */
+static bool var_store(VarTable *vars, const char *name, size_t length,
+		      const char *value, bool export)
+{
+	Variable *var = var_lookup(vars, name, length);
+	size_t value_len = strlen(value);
+
+	if (!var) {
+		size_t bucket = var_hash(name, length);
+
+		var = calloc(1, sizeof(Variable));
+		if (!var)
+			return false;
+		var->name = strndup(name, length);
+		if (!var->name) {
+			free(var);
+			return false;
+		}
+		var->next = vars->buckets[bucket];
+		vars->buckets[bucket] = var;
+	}
+
+	if (value_len + 1 > var->capacity) {
+		char *buffer = malloc(value_len + 1);
+		if (!buffer)
+			return false;
+		memcpy(buffer, value, value_len + 1);
+		free(var->value);
+		var->value = buffer;
+		var->capacity = value_len + 1;
+	} else {
+		memmove(var->value, value, value_len + 1);
+	}
+
+	if (export)
+		var->exported = true;
+	if (var->exported)
+		vars->environ_dirty = true;
+	return true;
+}
+
+/**
+ * var_init - Initializes a variable table from an environment.
+ * @vars: Pointer to the VarTable structure.
+ * @environ: NULL-terminated array of "name=value" strings.
+ * Return: true on success, false on allocation failure.
+ */
+bool var_init(VarTable *vars, char **environ)
+{
+	memset(vars, 0, sizeof(*vars));
+	vars->environ_dirty = true;
+
+	for (char **env = environ; env && *env; env++) {
+		char *eq = strchr(*env, '=');
+		if (!eq || eq == *env)
+			continue;
+		if (!var_store(vars, *env, eq - *env, eq + 1, true))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * var_get - Returns the value of a variable.
+ * @vars: Pointer to the VarTable structure.
+ * @name: The variable name.
+ * Return: The value, or NULL if the variable is not set.
+ */
+const char *var_get(VarTable *vars, const char *name)
+{
+	Variable *var = var_lookup(vars, name, strlen(name));
+
+	return var ? var->value : NULL;
+}
+
+/**
+ * var_set - Sets a variable.
+ * @vars: Pointer to the VarTable structure.
+ * @name: The variable name.
+ * @value: The new value.
+ * @export: Mark the variable for export to child processes.
+ * Return: true on success, false on allocation failure.
+ */
+bool var_set(VarTable *vars, const char *name, const char *value, bool export)
+{
+	return var_store(vars, name, strlen(name), value, export);
+}
+
+/**
+ * var_assign - Sets a variable from a "name=value" string.
+ * @vars: Pointer to the VarTable structure.
+ * @assignment: The assignment string.
+ * @export: Mark the variable for export to child processes.
+ * Return: true on success, false on allocation failure or missing '='.
+ */
+bool var_assign(VarTable *vars, char *assignment, bool export)
+{
+	char *eq = strchr(assignment, '=');
+
+	if (!eq)
+		return false;
+	return var_store(vars, assignment, eq - assignment, eq + 1, export);
+}
+
+/**
+ * var_assign_temporary - Sets a variable until var_restore is called.
+ * @vars: Pointer to the VarTable structure.
+ * @assignment: The "name=value" string, exported while it is in effect.
+ * @saved: List the old value is pushed onto.
+ *
+ * Used for the assignments in front of a function or builtin, as in
+ * "IFS=: read a b".
+ *
+ * Return: true on success, false on allocation failure or missing '='.
+ */
+bool var_assign_temporary(VarTable *vars, char *assignment,
+			  VarSaved **saved)
+{
+	char *eq = strchr(assignment, '=');
+	VarSaved *old;
+	Variable *var;
+
+	if (!eq)
+		return false;
+	old = calloc(1, sizeof(VarSaved));
+	if (!old)
+		return false;
+	old->name = strndup(assignment, eq - assignment);
+	var = var_lookup(vars, assignment, eq - assignment);
+	if (var) {
+		old->value = strdup(var->value);
+		old->exported = var->exported;
+	}
+	if (!old->name || (var && !old->value)) {
+		free(old->name);
+		free(old->value);
+		free(old);
+		return false;
+	}
+	old->next = *saved;
+	*saved = old;
+	return var_store(vars, assignment, eq - assignment, eq + 1, true);
+}
+
+/**
+ * var_restore - Undoes var_assign_temporary and frees the saved values.
+ * @vars: Pointer to the VarTable structure.
+ * @saved: The list filled in by var_assign_temporary, may be NULL.
+ *
+ * The list is newest first, so a name assigned twice gets its first
+ * saved value back.
+ */
+void var_restore(VarTable *vars, VarSaved *saved)
+{
+	while (saved) {
+		VarSaved *next = saved->next;
+
+		if (!saved->value) {
+			var_unset(vars, saved->name);
+		} else if (var_set(vars, saved->name, saved->value, false)) {
+			Variable *var = var_lookup(vars, saved->name,
+						   strlen(saved->name));
+			if (var->exported != saved->exported) {
+				var->exported = saved->exported;
+				vars->environ_dirty = true;
+			}
+		}
+		free(saved->name);
+		free(saved->value);
+		free(saved);
+		saved = next;
+	}
+}
+
+/**
+ * var_export - Marks an existing variable for export.
+ * @vars: Pointer to the VarTable structure.
+ * @name: The variable name.
+ * Return: true if the variable exists, false otherwise.
+ */
+bool var_export(VarTable *vars, const char *name)
+{
+	Variable *var = var_lookup(vars, name, strlen(name));
+
+	if (!var)
+		return false;
+	if (!var->exported) {
+		var->exported = true;
+		vars->environ_dirty = true;
+	}
+	return true;
+}
+
+/**
+ * var_unset - Removes a variable.
+ * @vars: Pointer to the VarTable structure.
+ * @name: The variable name.
+ */
+void var_unset(VarTable *vars, const char *name)
+{
+	Variable **link = &vars->buckets[var_hash(name, strlen(name))];
+
+	for (; *link; link = &(*link)->next) {
+		Variable *var = *link;
+		if (strcmp(var->name, name) != 0)
+			continue;
+		if (var->exported)
+			vars->environ_dirty = true;
+		*link = var->next;
+		free(var->name);
+		free(var->value);
+		free(var);
+		return;
+	}
+}
+
+/**
+ * var_free_environ - Frees the cached environment array.
+ * @vars: Pointer to the VarTable structure.
+ */
+static void var_free_environ(VarTable *vars)
+{
+	if (!vars->environ)
+		return;
+	for (char **env = vars->environ; *env; env++)
+		free(*env);
+	free(vars->environ);
+	vars->environ = NULL;
+}
+
+/**
+ * var_environ - Returns the environment for child processes.
+ * @vars: Pointer to the VarTable structure.
+ *
+ * The array is cached and only rebuilt after an exported variable changed.
+ *
+ * Return: NULL-terminated array of "name=value" strings, or NULL on failure.
+ */
+char **var_environ(VarTable *vars)
+{
+	size_t count = 0, index = 0;
+
+	if (!vars->environ_dirty && vars->environ)
+		return vars->environ;
+
+	var_free_environ(vars);
+	for (size_t b = 0; b < VAR_BUCKETS; b++) {
+		for (Variable *var = vars->buckets[b]; var; var = var->next)
+			count += var->exported;
+	}
+
+	vars->environ = malloc(sizeof(char *) * (count + 1));
+	if (!vars->environ)
+		return NULL;
+
+	for (size_t b = 0; b < VAR_BUCKETS; b++) {
+		for (Variable *var = vars->buckets[b]; var; var = var->next) {
+			if (!var->exported)
+				continue;
+			size_t name_len = strlen(var->name);
+			size_t value_len = strlen(var->value);
+			char *entry = malloc(name_len + value_len + 2);
+			if (!entry) {
+				vars->environ[index] = NULL;
+				var_free_environ(vars);
+				return NULL;
+			}
+			memcpy(entry, var->name, name_len);
+			entry[name_len] = '=';
+			memcpy(entry + name_len + 1, var->value,
+			       value_len + 1);
+			vars->environ[index++] = entry;
+		}
+	}
+	vars->environ[index] = NULL;
+	vars->environ_dirty = false;
+	return vars->environ;
+}
+
+/**
+ * var_free - Frees every variable in a table.
+ * @vars: Pointer to the VarTable structure.
+ */
+void var_free(VarTable *vars)
+{
+	var_free_environ(vars);
+	for (size_t b = 0; b < VAR_BUCKETS; b++) {
+		Variable *var = vars->buckets[b];
+		while (var) {
+			Variable *next = var->next;
+			free(var->name);
+			free(var->value);
+			free(var);
+			var = next;
+		}
+		vars->buckets[b] = NULL;
+	}
+}
@@ -0,0 +1,42 @@
+#ifndef VAR_H
+#define VAR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define VAR_BUCKETS 128
+
+typedef struct Variable {
+	char *name;
+	char *value;
+	size_t capacity;
+	bool exported;
+	struct Variable *next;
+} Variable;
+
+typedef struct VarSaved {
+	char *name;
+	char *value;
+	bool exported;
+	struct VarSaved *next;
+} VarSaved;
+
+typedef struct VarTable {
+	Variable *buckets[VAR_BUCKETS];
+	char **environ;
+	bool environ_dirty;
+} VarTable;
+
+bool var_init(VarTable *vars, char **environ);
+const char *var_get(VarTable *vars, const char *name);
+bool var_set(VarTable *vars, const char *name, const char *value, bool export);
+bool var_assign(VarTable *vars, char *assignment, bool export);
+bool var_assign_temporary(VarTable *vars, char *assignment,
+			  VarSaved **saved);
+void var_restore(VarTable *vars, VarSaved *saved);
+bool var_export(VarTable *vars, const char *name);
+void var_unset(VarTable *vars, const char *name);
+char **var_environ(VarTable *vars);
+void var_free(VarTable *vars);
+
+#endif
@@ -0,0 +1,13 @@
+# $((...)) in the shell, with C precedence and assignment operators
+i=0
+while [ $i -lt 5 ]; do i=$((i + 1)); done
+echo $i
+echo $((1 + 2 * 3)) $(((1 + 2) * 3)) $((7 / 2)) $((7 % 3)) $((-7 / 2))
+echo $((1 << 4)) $((255 & 15)) $((8 | 1)) $((6 ^ 3)) $((~0))
+echo $((3 > 2)) $((3 < 2)) $((2 == 2)) $((2 != 2)) $((!0))
+echo $((1 && 0)) $((0 || 5)) $((1 ? 10 : 20)) $((0 ? 10 : 20))
+x=5
+echo $((x += 3)) $((x -= 1)) $((x *= 2)) $((x <<= 1)) $x
+echo $((x++)) $x $((--x)) $x
+echo $((9223372036854775807 + 1))
+echo $((0x10 + 010))
@@ -0,0 +1,2 @@
+# the script ends inside $((, after the lexer has asked for more input
+echo 1$((1+2
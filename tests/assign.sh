@@ -0,0 +1,8 @@
+# assignments in front of a function last for the call only
+f() { echo "in f: FOO=$FOO"; sh -c 'echo "child: FOO=$FOO"'; }
+FOO=1 f
+echo "after: FOO=$FOO"
+FOO=old
+FOO=new f
+echo "after: FOO=$FOO"
+sh -c 'echo "child after: FOO=${FOO-unset}"'
@@ -0,0 +1,9 @@
+# assignments in front of a regular builtin last for the builtin only;
+# in front of a special builtin they stay set
+echo 'x:y z' > input
+IFS=: read a b < input
+echo "a=$a b=$b"
+read a b < input
+echo "a=$a b=$b"
+FOO=1 :
+echo "FOO=$FOO"
@@ -0,0 +1,6 @@
+# --bench runs a script N times and reports timings and counters per run;
+# a script that starts one program forks and execs once per run
+echo 'i=0; while [ $i -lt 3 ]; do i=$((i + 1)); done; /bin/true' > script
+$HSH --bench=3 script 2> report
+cut -f1 report
+grep -E '^(runs|forks|execs|spawns|path_found)	' report
@@ -0,0 +1,31 @@
+# literal, glob and expanded arms; the first matching arm wins
+suffix='*.sh'
+for w in run.sh abc abd a ab "" xyz x.c foo.c b*c bxc '[x' ']' aaa abab hello.txt README Makefile "a-b" 9 Z q; do
+case $w in
+	a) echo "$w 1";;
+	*.c|*.h) echo "$w 2";;
+	a?c) echo "$w 3";;
+	ab*) echo "$w 4";;
+	\[x) echo "$w 5";;
+	[[:upper:]]*[!a-z]) echo "$w 6";;
+	*a*b) echo "$w 7";;
+	[0-9]|[xyz]) echo "$w 8";;
+	b\*c) echo "$w 9";;
+	$suffix) echo "$w expanded";;
+	*.txt) echo "$w 10";;
+	"") echo "$w empty";;
+	*) echo "$w default";;
+esac
+done
+# a quoted expansion only matches itself
+p='a*'
+for w in ab 'a*'; do
+case $w in
+	"$p") echo "$w quoted";;
+	$p) echo "$w unquoted";;
+esac
+done
+p='[ab]'
+case a in "$p") echo bracket glob;; *) echo bracket literal;; esac
+case '[ab]' in "$p") echo bracket quoted;; esac
+case 'x[ab]?' in x"$p"?) echo mixed;; esac
@@ -0,0 +1,22 @@
+# if, while, until and for, with break and continue
+for x in 1 2 3; do
+	if [ $x = 1 ]; then echo "if $x"; elif [ $x = 2 ]; then echo "elif $x"; else echo "else $x"; fi
+done
+i=0
+while [ $i -lt 5 ]; do
+	i=$((i + 1))
+	[ $i = 2 ] && continue
+	[ $i = 4 ] && break
+	echo "while $i"
+done
+until [ $i = 0 ]; do i=$((i - 1)); done
+echo "until $i"
+for a in x y; do
+	for b in 1 2 3; do
+		[ $b = 2 ] && continue 2
+		echo "$a$b"
+	done
+done
+for a in x y; do for b in 1 2; do echo "$a$b"; break 2; done; done
+if false; then :; fi
+echo "empty if $?"
@@ -0,0 +1,11 @@
+# open quotes and trailing operators continue a command on the next line
+echo 'one
+two'
+echo "three
+four"
+echo five |
+tr a-z A-Z
+false ||
+echo six
+true &&
+echo seven
@@ -0,0 +1,12 @@
+# special parameters, including $$ unquoted, quoted and in braces
+echo $$ > pid1
+echo "$$" > pid2
+echo ${$} > pid3
+cmp pid1 pid2 && cmp pid1 pid3 && echo "\$\$ expands the same everywhere" | tr -d '\\'
+grep -q '^[0-9][0-9]*$' pid1 && echo "\$\$ is numeric" | tr -d '\\'
+echo "a$$$" | tr -d 0-9
+echo '$$' $
+false
+echo "$? ${?}"
+set_args() { echo "$# $*"; }
+set_args a b c
@@ -0,0 +1,18 @@
+# functions bind positional parameters and return a status
+show() { echo "$# args: $*"; for a in "$@"; do echo "[$a]"; done; }
+show one "two words" three
+fact() {
+	if [ $1 -le 1 ]; then result=1; return 0; fi
+	fact $(($1 - 1))
+	result=$((result * $1))
+}
+fact 5
+echo $result
+fails() { return 3; }
+fails
+echo "status $?"
+drop() { shift 2; echo "$@"; }
+drop a b c d
+echo "outer args: $#"
+echo() { printf 'shadowed\n'; }
+echo hi
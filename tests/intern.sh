@@ -0,0 +1,14 @@
+# words are interned in a bounded table; reusing, evicting and freeing
+# entries must never change what a command sees
+i=0
+while [ $i -lt 5000 ]; do
+	eval_word=w$i
+	case $eval_word in w4999) echo "reached $eval_word";; esac
+	i=$((i + 1))
+done
+for w in alpha beta alpha gamma beta alpha; do printf '%s ' $w; done
+echo
+f() { echo "$1 $1"; }
+f same
+f same
+echo done
@@ -0,0 +1,20 @@
+# hsh: -j 2
+# one job runs on the shell's own slot and one on the token; every other
+# job waits for a slot, and the shell waits for all of them before exiting
+(sleep 1; echo first) &
+(sleep 0.2; echo second) &
+echo third &
+(sleep 0.4; echo fourth) &
+# wait gives the tokens back before the script goes on
+wait
+echo waited
+(exit 3) &
+wait $!
+echo "status $?"
+(sleep 0.1; exit 4) &
+pid=$!
+(exit 5) &
+wait $pid $!
+echo "status $?"
+wait 1
+echo "unknown $?"
@@ -0,0 +1,8 @@
+# the metrics builtin prints OpenMetrics text ending in "# EOF"
+true
+sh -c :
+metrics > out
+grep -c '^# TYPE' out
+grep '^hsh_builtin_calls_total\|^hsh_spawns_total\|^hsh_execs_total' out
+tail -n 1 out
+grep -c '^hsh_spawn_latency_seconds_bucket' out
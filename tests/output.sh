@@ -0,0 +1,7 @@
+# standard output and standard error share one file here, and the shell's
+# own diagnostics must land between the lines around them
+echo one
+cd /nonexistent
+echo two
+shift 5
+echo three
@@ -0,0 +1,9 @@
+# a line waiting for its turn buffers at most 1 MiB of output and is then
+# held on its full pipe; nothing is lost or reordered
+echo 'sh -c "sleep 0.3; echo first"' > lines
+echo 'yes abc | head -c 3000000' >> lines
+echo 'echo last' >> lines
+$HSH -P 3 --keep-order lines > out
+head -n 2 out
+tail -n 2 out
+wc -c < out
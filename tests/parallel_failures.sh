@@ -0,0 +1,7 @@
+# hsh: -P 4
+# failed lines are reported in line order, whichever finishes first
+sh -c 'sleep 0.3; exit 1'
+true
+sh -c 'exit 2'
+sh -c 'sleep 0.1; exit 3'
+echo "last $?"
@@ -0,0 +1,8 @@
+# hsh: -P 3 --keep-order
+# output comes in line order, and a failing line in the middle is
+# reported between the output of the lines around it
+sh -c 'sleep 0.3; echo one'
+sh -c 'echo two; exit 4'
+echo three
+sh -c 'sleep 0.1; echo four'
+printf '%s\n' five six
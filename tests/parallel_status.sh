@@ -0,0 +1,11 @@
+# hsh: -P 4 --keep-order
+# a line reading $? waits for the lines before it, even inside a pipeline
+# or subshell, so it sees the same status as in a serial run
+sh -c 'sleep 0.2; exit 1'
+echo "pipe $?" | cat
+(exit 3)
+( echo "subshell $?" )
+sh -c 'sleep 0.1; exit 4'
+{ echo "group $?"; } | cat
+sh -c 'exit 5'
+echo "last $?"
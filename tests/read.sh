@@ -0,0 +1,14 @@
+# read takes one line at a time, so later commands see the rest of input
+printf 'first line\nsecond  line here\n  third\\\nline\nrest\n' > input
+{ read a; read b c; read -r d; cat; } < input
+echo "a=$a"
+echo "b=$b c=$c"
+echo "d=$d"
+{ read e; read f; } < input
+echo "e=$e f=$f"
+while read w1 w2; do echo "<$w1|$w2>"; done < input
+printf 'no newline' > partial
+read g < partial
+echo "status $? g=$g"
+read h < /dev/null
+echo "eof status $?"
@@ -0,0 +1,14 @@
+# hsh: --read-ahead
+# commands parsed ahead run in order, and a parse error is reported at
+# its own line after the output of the lines before it
+echo one
+sh -c 'sleep 0.1; echo two'
+x=3
+echo $x
+echo "four
+five"
+if true; then
+	echo six
+fi
+echo seven )
+echo eight
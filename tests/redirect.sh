@@ -0,0 +1,19 @@
+# builtins and compound commands get their redirections in the shell,
+# which puts every descriptor back afterwards
+echo one > out
+echo two >> out
+cat out
+{ echo three; echo four >&2; } > out 2>&1
+cat out
+exec_fd() { echo "to fd 3" >&3; }
+exec_fd 3> three
+cat three
+echo "still on stdout"
+echo hi >&-
+echo "status $?"
+echo err 2>&- >&2
+echo "status $?"
+read line < out
+echo "read: $line"
+while read l; do echo "loop: $l"; done < out
+echo done
@@ -0,0 +1,34 @@
+#!/bin/sh
+# Runs every tests/NAME.sh with hsh and compares its standard output and
+# standard error with tests/NAME.out. A first line of the form
+# "# hsh: FLAGS" passes FLAGS to hsh before the script name. Each script
+# is copied to an empty scratch directory and run there as test.sh, so
+# error messages read "test.sh: LINE: ...". $HSH names the shell under
+# test, for scripts that start it again.
+
+cd "$(dirname "$0")/.." || exit 1
+hsh=$(pwd)/hsh
+HSH=$hsh
+export HSH
+tests=$(pwd)/tests
+failed=0
+count=0
+
+for script in "$tests"/*.sh; do
+	name=$(basename "$script" .sh)
+	[ "$name" = run ] && continue
+	flags=$(sed -n '1s/^# hsh: //p' "$script")
+	scratch=$(mktemp -d) || exit 1
+	cp "$script" "$scratch/test.sh"
+	# shellcheck disable=SC2086
+	(cd "$scratch" && "$hsh" $flags test.sh 2>&1) > "$scratch.out"
+	count=$((count + 1))
+	if ! diff -u "$tests/$name.out" "$scratch.out"; then
+		echo "FAIL: $name"
+		failed=$((failed + 1))
+	fi
+	rm -rf "$scratch" "$scratch.out"
+done
+
+echo "$((count - failed)) of $count tests passed"
+[ "$failed" -eq 0 ]
@@ -0,0 +1,15 @@
+# groups run in the shell, subshells cannot change it, and redirections
+# after either apply to the whole command
+x=outer
+{ x=group; echo "in group $x"; }
+echo "after group $x"
+( x=sub; cd /; echo "in subshell $x" )
+echo "after subshell $x"
+( exit 7 )
+echo "status $?"
+{ echo a; echo b; } > out
+( echo c; echo d ) >> out
+cat out
+while read l; do echo "read $l"; done < out
+{ echo to-stderr >&2; } 2>&1
+( echo "piped" ) | tr a-z A-Z
@@ -0,0 +1,5 @@
+# the last command of a script is exec'd in place of the shell, so it
+# keeps the shell's process ID; earlier commands are forked as usual
+echo $$ > shellpid
+sh -c 'test "$$" != "$(cat shellpid)" && echo "first command forked"'
+sh -c 'test "$$" = "$(cat shellpid)" && echo "last command replaced the shell"'
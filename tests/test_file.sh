@@ -0,0 +1,16 @@
+# file operators, -r, -w and -x included, share one stat per path
+echo data > plain
+echo 'echo hi' > script
+chmod 644 plain
+chmod 755 script
+for f in plain script missing; do
+	if [ -f $f -a -r $f -a -w $f ]; then echo "$f: readable file"; fi
+	if [ -x $f ]; then echo "$f: executable"; else echo "$f: not executable"; fi
+	test -s $f -o -e $f || echo "$f: missing"
+done
+[ -d . -a -x . ] && echo ".: searchable directory"
+# with three arguments a binary operator comes before "!" and "("
+[ ! = x ]; echo "! = x: $?"
+[ ! = ! ]; echo "! = !: $?"
+[ '(' != ')' ]; echo "( != ): $?"
+[ ! -z x ]; echo "! -z x: $?"
@@ -0,0 +1,10 @@
+# time reports on standard error in TIMEFORMAT and keeps the status of
+# the pipeline it timed
+TIMEFORMAT='timed %%'
+time true
+time false | true
+echo "status $?"
+time true | false
+echo "status $?"
+TIMEFORMAT='%0R seconds'
+time sleep 0.1